@@ -0,0 +1,316 @@
+/** rm_bench - throughput of every compilation stage and matching engine.
+ *
+ * All inputs are generated here from fixed seeds, so every run and every
+ * engine sees the same bytes. Compilation stages are reported in patterns
+ * per second, matching and searching in megabytes of input per second.
+ * Each benchmark repeats its work until it has run for at least the minimum
+ * time; build with optimizations for meaningful numbers.
+ *
+ * usage: rm_bench [-t SECONDS] [FILTER]
+ * Only the benchmarks whose name contains FILTER are run.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "internal/glushkov.hpp"
+#include "internal/nfa_creation.hpp"
+#include "internal/parser.hpp"
+#include "internal/scanner.hpp"
+#include "regex_machine.hpp"
+
+namespace {
+
+constexpr std::string_view usage =
+    "usage: rm_bench [-t SECONDS] [FILTER]\n"
+    "  -t  minimum run time of each benchmark, 0.2 seconds by default\n";
+
+// A pattern and the inputs it is matched against as a whole.
+struct Workload {
+  std::string name;
+  std::string pattern;
+  std::vector<std::string> inputs;
+};
+
+const std::vector<std::pair<std::string_view, RM::Engine>> engines{
+    {"auto", RM::Engine::AUTO},
+    {"nfa", RM::Engine::NFA},
+    {"nfa_bitset", RM::Engine::NFA_BITSET},
+    {"lazy_dfa", RM::Engine::LAZY_DFA},
+    {"dfa", RM::Engine::DFA},
+    {"bitap", RM::Engine::BITAP},
+};
+
+// Keeps the compiler from dropping the benchmarked work.
+volatile size_t sink = 0;
+
+std::string random_string(std::mt19937& rng, std::string_view alphabet,
+                          size_t length) {
+  std::uniform_int_distribution<size_t> pick{0, alphabet.size() - 1};
+  std::string result(length, '\0');
+  for (char& c : result) {
+    c = alphabet[pick(rng)];
+  }
+  return result;
+}
+
+// Many short inputs, about half of which match.
+Workload short_inputs() {
+  std::mt19937 rng{1};
+  Workload result{"short", "ca(k|v)*e", {}};
+  for (size_t i = 0; i < 10000; ++i) {
+    const size_t length = 2 + i % 14;
+    result.inputs.push_back(i % 2 == 0
+                                ? "ca" + random_string(rng, "kv", length) + "e"
+                                : random_string(rng, "cakve", length + 3));
+  }
+  return result;
+}
+
+// One long matching input.
+Workload long_input() {
+  std::mt19937 rng{2};
+  return {"long", "(a|b)*abb", {random_string(rng, "ab", 1 << 20) + "abb"}};
+}
+
+// Ambiguous alternatives that keep many NFA states active on every byte.
+Workload pathological() {
+  return {"pathological", "(a|a)*(a|aa)*(a|a)*b",
+          {std::string(size_t{1} << 16, 'a')}};
+}
+
+// The classic pattern whose DFA has 2^11 states.
+Workload blowup() {
+  std::mt19937 rng{3};
+  return {"blowup", "(a|b)*a(a|b){10}", {random_string(rng, "ab", 1 << 20)}};
+}
+
+// Identifiers of bounded length, about half of which are too long.
+Workload identifiers() {
+  std::mt19937 rng{5};
+  Workload result{"counted", "[a-z][a-z0-9_]{2,31}", {}};
+  for (size_t i = 0; i < 10000; ++i) {
+    result.inputs.push_back(random_string(rng, "abcxyz", 1) +
+                            random_string(rng, "abcz019_", 2 + i % 60));
+  }
+  return result;
+}
+
+// Lines shaped like "2026-10-16 12:34:56 WARN auth: 42 request failed",
+// matched against a pattern for the ERROR and WARN ones.
+Workload log_lines() {
+  std::mt19937 rng{4};
+  const std::vector<std::string> levels{"INFO", "INFO", "INFO", "DEBUG",
+                                        "WARN", "ERROR"};
+  const std::vector<std::string> modules{"auth", "db", "http", "cache"};
+  const std::vector<std::string> words{"request", "failed", "user",
+                                       "timeout", "retry",  "ok"};
+  std::uniform_int_distribution<size_t> pick{0, 1000};
+  Workload result;
+  result.name = "log";
+  for (size_t i = 0; i < 20000; ++i) {
+    std::string line = "2026-10-16 12:" + random_string(rng, "012345", 1) +
+                       random_string(rng, "0123456789", 1) + ":" +
+                       random_string(rng, "012345", 1) +
+                       random_string(rng, "0123456789", 1) + " " +
+                       levels[pick(rng) % levels.size()] + " " +
+                       modules[pick(rng) % modules.size()] + ": " +
+                       std::to_string(pick(rng));
+    for (size_t w = pick(rng) % 6; w < 6; ++w) {
+      line += " " + words[pick(rng) % words.size()];
+    }
+    result.inputs.push_back(std::move(line));
+  }
+  const std::string digit = "[0-9]";
+  const std::string word = "[a-z]";
+  result.pattern = digit + "+\\-" + digit + "+\\-" + digit + "+\\ " + digit +
+                   "+\\:" + digit + "+\\:" + digit + "+\\ (ERROR|WARN)\\ " +
+                   word + "+\\:\\ " + digit + "+(\\ " + word + "+)*";
+  return result;
+}
+
+std::vector<Workload> workloads() {
+  return {short_inputs(), long_input(), pathological(), blowup(),
+          identifiers(), log_lines()};
+}
+
+/**
+ * Run `body` until `min_seconds` have passed and return the rate of units
+ * per second, where a call of `body` does `units` of them.
+ */
+template <typename Body>
+double rate(Body body, double units, double min_seconds) {
+  using clock = std::chrono::steady_clock;
+  body();
+  size_t iterations = 1;
+  while (true) {
+    const clock::time_point start = clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+      body();
+    }
+    const double seconds =
+        std::chrono::duration<double>(clock::now() - start).count();
+    if (seconds >= min_seconds) {
+      return units * static_cast<double>(iterations) / seconds;
+    }
+    iterations *= 2;
+  }
+}
+
+class Runner {
+ public:
+  Runner(std::string_view name_filter, double seconds)
+      : filter{name_filter}, min_seconds{seconds} {}
+
+  bool wanted(const std::string& name) const {
+    return name.find(filter) != std::string::npos;
+  }
+
+  template <typename Body>
+  void run(const std::string& name, const char* unit, double units,
+           Body body) const {
+    if (!wanted(name)) {
+      return;
+    }
+    const double per_second = rate(body, units, min_seconds);
+    std::printf("%-32s %14.2f %s\n", name.c_str(),
+                unit[0] == 'M' ? per_second / 1e6 : per_second, unit);
+    std::fflush(stdout);
+  }
+
+  void skip(const std::string& name, const std::string& reason) const {
+    if (wanted(name)) {
+      std::printf("%-32s %14s (%s)\n", name.c_str(), "-", reason.c_str());
+    }
+  }
+
+ private:
+  std::string_view filter;
+  double min_seconds;
+};
+
+void compile_benchmarks(const Runner& runner,
+                        const std::vector<Workload>& loads) {
+  using namespace RM::Impl;
+  std::vector<std::string> patterns;
+  for (const Workload& load : loads) {
+    patterns.push_back(load.pattern);
+  }
+  const auto count = static_cast<double>(patterns.size());
+
+  runner.run("scan", "patterns/s", count, [&]() {
+    for (const std::string& pattern : patterns) {
+      sink = sink + Scanner{pattern}.regex.size();
+    }
+  });
+  runner.run("parse", "patterns/s", count, [&]() {
+    for (const std::string& pattern : patterns) {
+      sink = sink + Parser{pattern}.parse().nodes.size();
+    }
+  });
+  runner.run("simplify", "patterns/s", count, [&]() {
+    for (const std::string& pattern : patterns) {
+      Parser::ParseResult parsed = Parser{pattern}.parse();
+      sink = sink + simplify(parsed).nodes_after;
+    }
+  });
+  runner.run("nfa/thompson", "patterns/s", count, [&]() {
+    for (const std::string& pattern : patterns) {
+      sink = sink + create_from_parse(Parser{pattern}.parse()).size;
+    }
+  });
+  runner.run("nfa/glushkov", "patterns/s", count, [&]() {
+    for (const std::string& pattern : patterns) {
+      sink = sink + create_glushkov(Parser{pattern}.parse()).size;
+    }
+  });
+  for (const auto& [engine_name, engine] : engines) {
+    runner.run("compile/" + std::string{engine_name}, "patterns/s", count,
+               [&]() {
+                 for (const std::string& pattern : patterns) {
+                   const RM::Matcher matcher{pattern, {.engine = engine}};
+                   sink = sink + matcher.err_msg.size();
+                 }
+               });
+  }
+}
+
+void match_benchmarks(const Runner& runner,
+                      const std::vector<Workload>& loads) {
+  for (const Workload& load : loads) {
+    double bytes = 0;
+    for (const std::string& input : load.inputs) {
+      bytes += static_cast<double>(input.size());
+    }
+    for (const auto& [engine_name, engine] : engines) {
+      const std::string name =
+          "match/" + load.name + "/" + std::string{engine_name};
+      if (!runner.wanted(name)) {
+        continue;
+      }
+      const RM::Matcher matcher{load.pattern, {.engine = engine}};
+      if (!matcher.err_msg.empty()) {
+        runner.skip(name, matcher.err_msg);
+        continue;
+      }
+      runner.run(name, "MB/s", bytes, [&]() {
+        for (const std::string& input : load.inputs) {
+          sink = sink + static_cast<size_t>(matcher.match(input));
+        }
+      });
+    }
+  }
+}
+
+// Leftmost-longest search for a word in a whole log file at once.
+void search_benchmarks(const Runner& runner, const Workload& log) {
+  std::string text;
+  for (const std::string& line : log.inputs) {
+    text += line;
+    text += '\n';
+  }
+  const RM::Matcher matcher{"ERROR|timeout"};
+  runner.run("find_all/log", "MB/s", static_cast<double>(text.size()),
+             [&]() {
+               for (const RM::Span span : matcher.find_all(text)) {
+                 sink = sink + span.end;
+               }
+             });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double min_seconds = 0.2;
+  std::string_view filter;
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i] == "-t" && i + 1 < args.size()) {
+      min_seconds = std::strtod(std::string{args[++i]}.c_str(), nullptr);
+    } else if (args[i].starts_with('-') || !filter.empty()) {
+      std::fprintf(stderr, "rm_bench: unexpected argument %s\n%s",
+                   std::string{args[i]}.c_str(), usage.data());
+      return 2;
+    } else {
+      filter = args[i];
+    }
+  }
+  if (min_seconds <= 0) {
+    std::fprintf(stderr, "rm_bench: -t needs a positive number\n%s",
+                 usage.data());
+    return 2;
+  }
+
+  const std::vector<Workload> loads = workloads();
+  const Runner runner{filter, min_seconds};
+  compile_benchmarks(runner, loads);
+  match_benchmarks(runner, loads);
+  search_benchmarks(runner, loads.back());
+  return 0;
+}
@@ -5,6 +5,16 @@ if(BUILD_TESTING)
   add_subdirectory(test)
 endif()
 
+option(BUILD_TOOLS "Build the command-line tools" ON)
+if(BUILD_TOOLS)
+  add_subdirectory(tools)
+endif()
+
+option(BUILD_BENCHMARKS "Build the benchmark suite" ON)
+if(BUILD_BENCHMARKS)
+  add_subdirectory(benchmark)
+endif()
+
 option(ENABLE_COVERAGE "Enable coverage support separate from CTest's" OFF)
 if(ENABLE_COVERAGE)
   include(cmake/coverage.cmake)
@@ -3,6 +3,8 @@ set(
     source/*.cpp source/*.hpp
     include/*.hpp
     test/*.cpp test/*.hpp
+    tools/*.cpp tools/*.hpp
+    benchmark/*.cpp benchmark/*.hpp
     CACHE STRING
     "; separated patterns relative to the project source dir to format"
 )
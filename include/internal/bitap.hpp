@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <ranges>
+#include <string_view>
+
+#include "glushkov.hpp"
+#include "input.hpp"
+#include "stats.hpp"
+
+namespace RM::Impl {
+
+/** A bit-parallel (Shift-And style) matcher for regexes with at most 64
+ * character positions.
+ *
+ * Bit `p - 1` of a mask stands for position `p` of the position automaton,
+ * so the whole set of active states fits in one machine word. A step is the
+ * union of the follow sets of the active positions, looked up 8 positions at
+ * a time in precomputed tables, masked by the positions labeled with the byte
+ * just read.
+ */
+class Bitap {
+ public:
+  using mask = std::uint64_t;
+  static constexpr size_t max_positions = 64;
+  static constexpr size_t chunk_bits = 8;
+  static constexpr size_t alphabet_size = 256;
+  enum class err_state : char { OK = 0, BAD_PARSE, TOO_MANY_POSITIONS };
+
+  constexpr bool match(std::string_view s) const {
+    NoStats none;
+    return match(s, none);
+  }
+
+  template <CharRange R, typename Stats>
+  constexpr bool match(R&& s, Stats& stats) const {
+    auto it = std::ranges::begin(s);
+    const auto end = std::ranges::end(s);
+    if (it == end) {
+      return nullable;
+    }
+    mask active = first & byte_masks[static_cast<unsigned char>(*it)];
+    stats.read(1);
+    if constexpr (Stats::enabled) {
+      stats.active(static_cast<size_t>(std::popcount(active)));
+    }
+    for (++it; it != end; ++it) {
+      if (active == 0) {
+        return false;
+      }
+      active = follow(active) & byte_masks[static_cast<unsigned char>(*it)];
+      stats.read(1);
+      if constexpr (Stats::enabled) {
+        stats.active(static_cast<size_t>(std::popcount(active)));
+      }
+    }
+    return (active & last) != 0;
+  }
+
+  // The positions active after reading `c`, `at_start` when nothing has
+  // been read yet.
+  constexpr mask next(mask active, bool at_start, char c) const {
+    return (at_start ? first : follow(active)) &
+           byte_masks[static_cast<unsigned char>(c)];
+  }
+
+  constexpr mask follow(mask active) const {
+    mask result = 0;
+    for (size_t k = 0; k < chunks; ++k) {
+      result |= follow_tables[k][(active >> (k * chunk_bits)) & 0xFFU];
+    }
+    return result;
+  }
+
+  std::array<mask, alphabet_size> byte_masks{};
+  std::array<std::array<mask, alphabet_size>, max_positions / chunk_bits>
+      follow_tables{};
+  mask first = 0;
+  mask last = 0;
+  size_t chunks = 0;
+  bool nullable = false;
+  err_state error = err_state::OK;
+};
+
+/**
+ * Compile a position automaton into the masks and follow tables of Bitap.
+ * Fails with TOO_MANY_POSITIONS if it has more than 64 positions.
+ * Usable at compile time.
+ */
+constexpr Bitap create_bitap(const PositionAutomaton& positions) {
+  Bitap result;
+  if (positions.too_large) [[unlikely]] {
+    result.error = Bitap::err_state::TOO_MANY_POSITIONS;
+    return result;
+  }
+  if (!positions.valid) [[unlikely]] {
+    result.error = Bitap::err_state::BAD_PARSE;
+    return result;
+  }
+  const size_t n = positions.position_count();
+  if (n > Bitap::max_positions) {
+    result.error = Bitap::err_state::TOO_MANY_POSITIONS;
+    return result;
+  }
+
+  const auto to_mask = [](const StateBitset& set) {
+    Bitap::mask m = 0;
+    set.for_each([&](size_t p) {
+      if (p != 0) {
+        m |= Bitap::mask{1} << (p - 1);
+      }
+    });
+    return m;
+  };
+  std::array<Bitap::mask, Bitap::max_positions> follow_masks{};
+  for (size_t p = 1; p <= n; ++p) {
+    positions.labels[p].for_each_range([&](char first, char last) {
+      for (size_t b = static_cast<unsigned char>(first);
+           b <= static_cast<unsigned char>(last); ++b) {
+        result.byte_masks[b] |= Bitap::mask{1} << (p - 1);
+      }
+    });
+    follow_masks[p - 1] = to_mask(positions.follow[p]);
+  }
+  result.first = to_mask(positions.first);
+  result.last = to_mask(positions.last);
+  result.nullable = positions.nullable;
+
+  result.chunks = (n + Bitap::chunk_bits - 1) / Bitap::chunk_bits;
+  for (size_t k = 0; k < result.chunks; ++k) {
+    auto& table = result.follow_tables[k];
+    for (size_t v = 1; v < Bitap::alphabet_size; ++v) {
+      const auto low = static_cast<size_t>(std::countr_zero(v));
+      table[v] = table[v & (v - 1)] | follow_masks[k * Bitap::chunk_bits + low];
+    }
+  }
+  return result;
+}
+
+/**
+ * Compile a parse tree into Bitap. The positions are counted first, so a
+ * tree with more than 64 of them fails with TOO_MANY_POSITIONS before any
+ * follow set is built. Usable at compile time.
+ */
+constexpr Bitap create_bitap(const Parser::ParseResult& parsed) {
+  if (parsed.err_msg.empty() &&
+      count_positions(parsed) > Bitap::max_positions) {
+    Bitap result;
+    result.error = Bitap::err_state::TOO_MANY_POSITIONS;
+    return result;
+  }
+  return create_bitap(create_positions(parsed));
+}
+
+}  // namespace RM::Impl
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace RM::Impl {
+
+/** A partition of the 256 byte values into classes that no transition of an
+ * automaton tells apart, so that transition tables can have one column per
+ * class instead of one per byte.
+ *
+ * Every byte range some NFA transition reads splits the classes it cuts
+ * through, and new classes are numbered in the order they appear. Class 0
+ * starts with all the bytes and keeps the ones no transition reads, if any.
+ * The DFA may later merge classes that its states all treat the same, see
+ * `merge`.
+ */
+class ByteClasses {
+ public:
+  using id = std::uint8_t;
+  static constexpr size_t alphabet_size = 256;
+
+  id of(char c) const { return map[static_cast<unsigned char>(c)]; }
+  size_t size() const { return count; }
+
+  // Whether some transition reads `c`. Only exact before `merge`.
+  bool reads(char c) const { return read[of(c)]; }
+
+  void add(char c) { add_range(c, c); }
+
+  // Make the bytes from `first` to `last` (as unsigned, both included) a
+  // union of classes and mark them read.
+  void add_range(char first, char last) {
+    const auto lo = static_cast<unsigned char>(first);
+    const auto hi = static_cast<unsigned char>(last);
+    std::array<size_t, alphabet_size> inside{};
+    for (size_t b = lo; b <= hi; ++b) {
+      ++inside[map[b]];
+    }
+    std::array<size_t, alphabet_size> total{};
+    for (const id c : map) {
+      ++total[c];
+    }
+    // A class that lies partly in the range is split, its inner part
+    // becoming a new class.
+    std::array<id, alphabet_size> moved_to{};
+    for (size_t b = lo; b <= hi; ++b) {
+      const id c = map[b];
+      if (inside[c] == total[c]) {
+        read[c] = true;
+        continue;
+      }
+      if (moved_to[c] == 0) {
+        moved_to[c] = static_cast<id>(count);
+        read[count++] = true;
+      }
+      map[b] = moved_to[c];
+    }
+  }
+
+  // The bytes read by some transition, in increasing order.
+  std::vector<char> bytes() const {
+    std::vector<char> result;
+    for (size_t b = 0; b < alphabet_size; ++b) {
+      if (reads(static_cast<char>(b))) {
+        result.push_back(static_cast<char>(b));
+      }
+    }
+    return result;
+  }
+
+  // A byte of every class, indexed by class.
+  std::vector<char> representatives() const {
+    std::vector<char> result(count);
+    for (size_t b = alphabet_size; b-- > 0;) {
+      result[map[b]] = static_cast<char>(b);
+    }
+    return result;
+  }
+
+  /**
+   * Renumber the classes by `new_ids`, indexed by the old class, which must
+   * map onto [0, new_count). Classes given the same new id are merged.
+   */
+  void merge(const std::vector<size_t>& new_ids, size_t new_count) {
+    std::array<bool, alphabet_size> merged_read{};
+    for (size_t c = 0; c < count; ++c) {
+      merged_read[new_ids[c]] = merged_read[new_ids[c]] || read[c];
+    }
+    for (id& c : map) {
+      c = static_cast<id>(new_ids[c]);
+    }
+    count = new_count;
+    read = merged_read;
+  }
+
+  bool operator==(const ByteClasses&) const = default;
+
+  std::array<id, alphabet_size> map{};
+  size_t count = 1;
+  // Indexed by class.
+  std::array<bool, alphabet_size> read{};
+};
+
+}  // namespace RM::Impl
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace RM::Impl {
+
+/** A set of byte values, the label of a character class like "[a-z0-9]".
+ * It is constexpr, like the Scanner that builds it.
+ */
+class ByteSet {
+ public:
+  using word = std::uint64_t;
+  static constexpr size_t alphabet_size = 256;
+  static constexpr size_t word_bits = 64;
+
+  static constexpr ByteSet single(char c) {
+    ByteSet result;
+    result.insert(c);
+    return result;
+  }
+
+  // What "." matches: every byte but the newline.
+  static constexpr ByteSet wildcard() {
+    ByteSet result;
+    result.insert_range('\0', static_cast<char>(alphabet_size - 1));
+    result.erase('\n');
+    return result;
+  }
+
+  constexpr void insert(char c) {
+    const auto b = static_cast<unsigned char>(c);
+    words[b / word_bits] |= word{1} << (b % word_bits);
+  }
+
+  constexpr void erase(char c) {
+    const auto b = static_cast<unsigned char>(c);
+    words[b / word_bits] &= ~(word{1} << (b % word_bits));
+  }
+
+  // Insert the bytes from `first` to `last`, both included, as unsigned.
+  constexpr void insert_range(char first, char last) {
+    for (size_t b = static_cast<unsigned char>(first);
+         b <= static_cast<unsigned char>(last); ++b) {
+      insert(static_cast<char>(b));
+    }
+  }
+
+  constexpr bool contains(char c) const {
+    const auto b = static_cast<unsigned char>(c);
+    return ((words[b / word_bits] >> (b % word_bits)) & word{1}) != 0;
+  }
+
+  constexpr ByteSet complement() const {
+    ByteSet result;
+    for (size_t i = 0; i < words.size(); ++i) {
+      result.words[i] = ~words[i];
+    }
+    return result;
+  }
+
+  // The bytes of this set that are not in `other`.
+  constexpr ByteSet minus(const ByteSet& other) const {
+    ByteSet result;
+    for (size_t i = 0; i < words.size(); ++i) {
+      result.words[i] = words[i] & ~other.words[i];
+    }
+    return result;
+  }
+
+  constexpr void insert_all(const ByteSet& other) {
+    for (size_t i = 0; i < words.size(); ++i) {
+      words[i] |= other.words[i];
+    }
+  }
+
+  constexpr size_t count() const {
+    size_t result = 0;
+    for (const word w : words) {
+      result += static_cast<size_t>(std::popcount(w));
+    }
+    return result;
+  }
+
+  // Call `f(first, last)` for every maximal run of consecutive bytes.
+  template <typename F>
+  constexpr void for_each_range(F&& f) const {
+    size_t b = 0;
+    while (b < alphabet_size) {
+      if (!contains(static_cast<char>(b))) {
+        ++b;
+        continue;
+      }
+      const size_t first = b;
+      while (b < alphabet_size && contains(static_cast<char>(b))) {
+        ++b;
+      }
+      f(static_cast<char>(first), static_cast<char>(b - 1));
+    }
+  }
+
+  bool operator==(const ByteSet&) const = default;
+
+  std::array<word, alphabet_size / word_bits> words{};
+};
+
+}  // namespace RM::Impl
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "byte_classes.hpp"
+#include "input.hpp"
+#include "nfa.hpp"
+#include "state_bitset.hpp"
+#include "stats.hpp"
+
+namespace RM::Impl {
+
+/** A complete DFA with a single flat transition table.
+ * Row `s` of the table holds the next state for each byte class, see
+ * ByteClasses, so a row is usually a few entries instead of 256 and the
+ * rows in use stay in cache. Bytes that lead nowhere go to `dead_state`,
+ * which loops on itself and is not accepting, so matching can stop as soon
+ * as it is entered.
+ */
+class DFA {
+ public:
+  using state = std::uint32_t;
+  static constexpr size_t alphabet_size = 256;
+  enum class err_state : char { OK = 0, TOO_MANY_STATES };
+
+  bool match(std::string_view s) const {
+    NoStats none;
+    return match(s, none);
+  }
+
+  template <CharRange R, typename Stats>
+  bool match(R&& s, Stats& stats) const {
+    state current = initial_state;
+    const size_t columns = classes.size();
+    for (const char c : s) {
+      stats.read(1);
+      stats.active(1);
+      current = table[current * columns + classes.of(c)];
+      if (current == dead_state) {
+        return false;
+      }
+    }
+    return accepting[current] != 0;
+  }
+
+  state next(state from, char c) const {
+    return table[from * classes.size() + classes.of(c)];
+  }
+
+  ByteClasses classes;
+  std::vector<state> table;
+  std::vector<char> accepting;
+  size_t size{};
+  state initial_state{};
+  state dead_state{};
+  err_state error = err_state::OK;
+};
+
+namespace DFAImpl {
+
+/** A partition of DFA states that can be refined by marking a subset of a
+ * block and splitting the marked part off. Every block is a contiguous range
+ * of `elems`, with the marked states at its front.
+ */
+struct Partition {
+  struct block {
+    size_t begin;
+    size_t end;
+    size_t marked;
+  };
+
+  explicit Partition(size_t n) : elems(n), location(n), block_of(n, 0) {
+    for (size_t i = 0; i < n; ++i) {
+      elems[i] = static_cast<DFA::state>(i);
+      location[i] = i;
+    }
+    blocks.push_back({.begin = 0, .end = n, .marked = 0});
+  }
+
+  void mark(DFA::state s) {
+    block& b = blocks[block_of[s]];
+    const size_t pos = location[s];
+    if (pos < b.begin + b.marked) {
+      return;
+    }
+    const size_t target = b.begin + b.marked;
+    std::swap(elems[pos], elems[target]);
+    location[elems[pos]] = pos;
+    location[elems[target]] = target;
+    if (b.marked++ == 0) {
+      touched.push_back(block_of[s]);
+    }
+  }
+
+  /**
+   * Split the marked part off every touched block that is only partially
+   * marked. `on_split(old, added)` is called for each split; the marked part
+   * becomes the new block.
+   */
+  template <typename F>
+  void split(F&& on_split) {
+    for (const size_t id : touched) {
+      block& b = blocks[id];
+      const size_t marked_end = b.begin + b.marked;
+      b.marked = 0;
+      if (marked_end == b.end) {
+        continue;
+      }
+      const size_t added = blocks.size();
+      const size_t begin = b.begin;
+      b.begin = marked_end;
+      blocks.push_back({.begin = begin, .end = marked_end, .marked = 0});
+      for (size_t i = begin; i < marked_end; ++i) {
+        block_of[elems[i]] = added;
+      }
+      on_split(id, added);
+    }
+    touched.clear();
+  }
+
+  size_t block_size(size_t id) const {
+    return blocks[id].end - blocks[id].begin;
+  }
+
+  std::vector<DFA::state> elems;
+  std::vector<size_t> location;
+  std::vector<size_t> block_of;
+  std::vector<block> blocks;
+  std::vector<size_t> touched;
+};
+
+/**
+ * Merge the byte classes whose columns are equal in every row, like those of
+ * "a" and "b" in "(a|b)*c" once minimized. The columns are sorted to bring
+ * equal ones together, and the merged classes keep the order of their
+ * first members.
+ */
+inline void merge_classes(DFA& dfa) {
+  const size_t columns = dfa.classes.size();
+  const auto column_less = [&](size_t a, size_t b) {
+    for (size_t s = 0; s < dfa.size; ++s) {
+      const DFA::state x = dfa.table[s * columns + a];
+      const DFA::state y = dfa.table[s * columns + b];
+      if (x != y) {
+        return x < y;
+      }
+    }
+    return a < b;
+  };
+  const auto column_equal = [&](size_t a, size_t b) {
+    for (size_t s = 0; s < dfa.size; ++s) {
+      if (dfa.table[s * columns + a] != dfa.table[s * columns + b]) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  std::vector<size_t> order(columns);
+  for (size_t c = 0; c < columns; ++c) {
+    order[c] = c;
+  }
+  std::sort(order.begin(), order.end(), column_less);
+  // Each class is first mapped to the smallest class with the same column.
+  std::vector<size_t> first_of(columns);
+  for (size_t i = 0; i < columns; ++i) {
+    first_of[order[i]] = i > 0 && column_equal(order[i - 1], order[i])
+                             ? first_of[order[i - 1]]
+                             : order[i];
+  }
+  std::vector<size_t> new_ids(columns);
+  std::vector<size_t> kept;
+  for (size_t c = 0; c < columns; ++c) {
+    if (first_of[c] == c) {
+      new_ids[c] = kept.size();
+      kept.push_back(c);
+    } else {
+      new_ids[c] = new_ids[first_of[c]];
+    }
+  }
+  if (kept.size() == columns) {
+    return;
+  }
+
+  std::vector<DFA::state> table(dfa.size * kept.size());
+  for (size_t s = 0; s < dfa.size; ++s) {
+    for (size_t k = 0; k < kept.size(); ++k) {
+      table[s * kept.size() + k] = dfa.table[s * columns + kept[k]];
+    }
+  }
+  dfa.table = std::move(table);
+  dfa.classes.merge(new_ids, kept.size());
+}
+
+}  // namespace DFAImpl
+
+/**
+ * Build a complete DFA from an NFA with the subset construction.
+ *
+ * The NFA must be valid. The DFA has the byte classes of the NFA, and one
+ * byte of each class is explored. If more than `max_states` states are
+ * needed, the construction stops and the result has the TOO_MANY_STATES
+ * error.
+ */
+inline DFA create_dfa(const NFA& nfa, size_t max_states) {
+  DFA result;
+  result.classes = nfa.byte_classes;
+  const size_t columns = result.classes.size();
+  const std::vector<char> symbols = result.classes.representatives();
+  std::vector<StateBitset> sets;
+  std::unordered_map<std::vector<StateBitset::word>, DFA::state, words_hash>
+      index;
+  std::vector<NFA::state> stack;
+  stack.reserve(nfa.size);
+
+  const auto intern = [&](StateBitset&& set) -> DFA::state {
+    if (const auto it = index.find(set.words); it != index.end()) {
+      return it->second;
+    }
+    const auto id = static_cast<DFA::state>(sets.size());
+    index.emplace(set.words, id);
+    result.accepting.push_back(
+        static_cast<char>(set.contains(nfa.final_state)));
+    sets.push_back(std::move(set));
+    return id;
+  };
+
+  result.dead_state = intern(StateBitset{nfa.size});
+  StateBitset initial{nfa.size};
+  nfa.add_closure(initial, nfa.initial_state, stack);
+  result.initial_state = intern(std::move(initial));
+
+  StateBitset next{nfa.size};
+  for (size_t s = 0; s < sets.size(); ++s) {
+    if (sets.size() > max_states) {
+      result.error = DFA::err_state::TOO_MANY_STATES;
+      return result;
+    }
+    result.table.resize(sets.size() * columns, result.dead_state);
+    for (size_t c = 0; c < columns; ++c) {
+      nfa.step(sets[s], symbols[c], next, stack);
+      const DFA::state to = intern(std::move(next));
+      next = StateBitset{nfa.size};
+      result.table[s * columns + c] = to;
+    }
+  }
+  if (sets.size() > max_states) {
+    result.error = DFA::err_state::TOO_MANY_STATES;
+    return result;
+  }
+  result.size = sets.size();
+  return result;
+}
+
+/**
+ * Minimize a complete DFA with Hopcroft's partition refinement.
+ *
+ * States are first split into accepting and non-accepting ones, then blocks
+ * are split by their predecessors on each byte class until no block
+ * distinguishes any other. The blocks left are the states of the minimal
+ * DFA. Byte classes that all its states treat the same are then merged.
+ */
+inline DFA minimize(DFA&& dfa) {
+  if (dfa.error != DFA::err_state::OK || dfa.size == 0) {
+    return std::move(dfa);
+  }
+  const size_t n = dfa.size;
+  const size_t columns = dfa.classes.size();
+
+  // Only classes on which some state does not go to the dead state can tell
+  // states apart.
+  std::vector<size_t> symbols;
+  for (size_t c = 0; c < columns; ++c) {
+    for (size_t s = 0; s < n; ++s) {
+      if (dfa.table[s * columns + c] != dfa.dead_state) {
+        symbols.push_back(c);
+        break;
+      }
+    }
+  }
+  const size_t k = symbols.size();
+
+  // Predecessors of every state on every used byte, as offset ranges into
+  // one array.
+  std::vector<size_t> inverse_offsets(k * n + 1, 0);
+  for (size_t a = 0; a < k; ++a) {
+    for (size_t s = 0; s < n; ++s) {
+      ++inverse_offsets[a * n + dfa.table[s * columns + symbols[a]] + 1];
+    }
+  }
+  for (size_t i = 1; i < inverse_offsets.size(); ++i) {
+    inverse_offsets[i] += inverse_offsets[i - 1];
+  }
+  std::vector<DFA::state> inverse(inverse_offsets.back());
+  {
+    std::vector<size_t> fill(inverse_offsets.begin(),
+                             inverse_offsets.end() - 1);
+    for (size_t a = 0; a < k; ++a) {
+      for (size_t s = 0; s < n; ++s) {
+        const DFA::state to = dfa.table[s * columns + symbols[a]];
+        inverse[fill[a * n + to]++] = static_cast<DFA::state>(s);
+      }
+    }
+  }
+
+  DFAImpl::Partition partition{n};
+  for (size_t s = 0; s < n; ++s) {
+    if (dfa.accepting[s] != 0) {
+      partition.mark(static_cast<DFA::state>(s));
+    }
+  }
+  partition.split([](size_t, size_t) {});
+
+  std::vector<std::pair<size_t, size_t>> work;
+  std::vector<char> in_work;
+  const auto push_work = [&](size_t block, size_t a) {
+    if (in_work.size() < partition.blocks.size() * k) {
+      in_work.resize(partition.blocks.size() * k, 0);
+    }
+    if (in_work[block * k + a] == 0) {
+      in_work[block * k + a] = 1;
+      work.emplace_back(block, a);
+    }
+  };
+  const size_t smaller =
+      partition.blocks.size() == 1 ||
+              partition.block_size(0) <= partition.block_size(1)
+          ? 0
+          : 1;
+  for (size_t a = 0; a < k; ++a) {
+    push_work(smaller, a);
+  }
+
+  std::vector<DFA::state> splitter;
+  while (!work.empty()) {
+    const auto [block, a] = work.back();
+    work.pop_back();
+    in_work[block * k + a] = 0;
+
+    splitter.assign(
+        partition.elems.begin() +
+            static_cast<std::ptrdiff_t>(partition.blocks[block].begin),
+        partition.elems.begin() +
+            static_cast<std::ptrdiff_t>(partition.blocks[block].end));
+    for (const DFA::state to : splitter) {
+      for (size_t i = inverse_offsets[a * n + to];
+           i < inverse_offsets[a * n + to + 1]; ++i) {
+        partition.mark(inverse[i]);
+      }
+    }
+    partition.split([&](size_t old_block, size_t added) {
+      for (size_t b = 0; b < k; ++b) {
+        if (in_work.size() < partition.blocks.size() * k) {
+          in_work.resize(partition.blocks.size() * k, 0);
+        }
+        if (in_work[old_block * k + b] != 0 ||
+            partition.block_size(added) <= partition.block_size(old_block)) {
+          push_work(added, b);
+        } else {
+          push_work(old_block, b);
+        }
+      }
+    });
+  }
+
+  DFA result;
+  result.size = partition.blocks.size();
+  result.classes = dfa.classes;
+  result.table.resize(result.size * columns);
+  result.accepting.resize(result.size);
+  for (size_t b = 0; b < result.size; ++b) {
+    const DFA::state representative =
+        partition.elems[partition.blocks[b].begin];
+    result.accepting[b] = dfa.accepting[representative];
+    for (size_t c = 0; c < columns; ++c) {
+      result.table[b * columns + c] = static_cast<DFA::state>(
+          partition.block_of[dfa.table[representative * columns + c]]);
+    }
+  }
+  result.initial_state =
+      static_cast<DFA::state>(partition.block_of[dfa.initial_state]);
+  result.dead_state =
+      static_cast<DFA::state>(partition.block_of[dfa.dead_state]);
+  DFAImpl::merge_classes(result);
+  return result;
+}
+
+}  // namespace RM::Impl
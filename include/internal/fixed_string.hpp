@@ -0,0 +1,26 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace RM::Impl {
+
+/** A string literal that can be passed as a template argument: `T<"ab*">`.
+ * N counts the terminating null character, which `str` leaves out.
+ */
+template <size_t N>
+struct FixedString {
+  // Implicit, so that a string literal converts to it.
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  constexpr FixedString(const char (&s)[N]) {
+    std::copy_n(s, N, chars.begin());
+  }
+
+  constexpr std::string str() const { return {chars.data(), N - 1}; }
+
+  std::array<char, N> chars{};
+};
+
+}  // namespace RM::Impl
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vector>
+
+#include "byte_set.hpp"
+#include "nfa.hpp"
+#include "parser.hpp"
+#include "state_bitset.hpp"
+
+namespace RM::Impl {
+
+/** The position automaton of a regex.
+ * Every character or class of the regex is a position, labeled with the
+ * bytes it reads and numbered 1..n from left to right, and 0 stands for the
+ * start. `follow[p]` holds the positions that can come right after position
+ * `p` in a matching string, `first` and `last` the positions a match can start
+ * and end with, and `nullable` tells whether the empty string matches. All
+ * sets are n + 1 bits wide.
+ *
+ * The follow sets take (n + 1)^2 bits, and chains of nullable nodes like
+ * "(a?){1000}" fill them, so past `max_follow_bits` the automaton is
+ * `too_large` and not built.
+ */
+struct PositionAutomaton {
+  static constexpr size_t max_follow_bits = size_t{1} << 28;
+  // The most follow pairs, so NFA edges, `create_glushkov` builds.
+  static constexpr size_t max_follow_pairs = size_t{1} << 22;
+
+  std::vector<ByteSet> labels;
+  std::vector<StateBitset> follow;
+  StateBitset first;
+  StateBitset last;
+  bool nullable = false;
+  bool valid = true;
+  bool too_large = false;
+
+  constexpr size_t position_count() const { return labels.size() - 1; }
+};
+
+// The number of positions of a parse tree: its characters and classes.
+constexpr size_t count_positions(const Parser::ParseResult& parsed) {
+  size_t n = 0;
+  for (const ParseNode& node : parsed.nodes) {
+    n += static_cast<size_t>(node.type == ParseNode::NodeType::CHAR ||
+                             node.type == ParseNode::NodeType::CLASS);
+  }
+  return n;
+}
+
+/**
+ * Compute the nullable/first/last/follow sets of a parse tree.
+ * The result is invalid if the tree has an error or an unknown node type,
+ * or if it is too large. Usable at compile time.
+ */
+constexpr PositionAutomaton create_positions(
+    const Parser::ParseResult& parsed) {
+  using NodeType = ParseNode::NodeType;
+  PositionAutomaton result;
+  if (!parsed.err_msg.empty()) [[unlikely]] {
+    result.valid = false;
+    return result;
+  }
+
+  const std::vector<ParseNode>& nodes = parsed.nodes;
+  const size_t n = count_positions(parsed);
+  if ((n + 1) * (n + 1) > PositionAutomaton::max_follow_bits) [[unlikely]] {
+    result.valid = false;
+    result.too_large = true;
+    return result;
+  }
+  result.labels.assign(n + 1, ByteSet{});
+  result.follow.assign(n + 1, StateBitset{n + 1});
+
+  struct sets {
+    bool nullable;
+    StateBitset first;
+    StateBitset last;
+  };
+  size_t next_position = 1;
+  const auto visit = [&](ParseNode::index i, auto& f) -> sets {
+    const auto [left, right, type, character, set] =
+        nodes[static_cast<size_t>(i)];
+    switch (type) {
+      case NodeType::CHAR:
+      case NodeType::CLASS: {
+        const size_t p = next_position++;
+        result.labels[p] = type == NodeType::CHAR
+                               ? ByteSet::single(character)
+                               : parsed.sets[static_cast<size_t>(set)];
+        sets leaf{false, StateBitset{n + 1}, StateBitset{n + 1}};
+        leaf.first.insert(p);
+        leaf.last.insert(p);
+        return leaf;
+      }
+      case NodeType::OR: {
+        sets l = f(left, f);
+        const sets r = f(right, f);
+        l.nullable = l.nullable || r.nullable;
+        l.first.insert_all(r.first);
+        l.last.insert_all(r.last);
+        return l;
+      }
+      case NodeType::CONCAT: {
+        sets l = f(left, f);
+        sets r = f(right, f);
+        l.last.for_each(
+            [&](size_t p) { result.follow[p].insert_all(r.first); });
+        if (l.nullable) {
+          l.first.insert_all(r.first);
+        }
+        if (r.nullable) {
+          r.last.insert_all(l.last);
+        }
+        return {l.nullable && r.nullable, std::move(l.first),
+                std::move(r.last)};
+      }
+      case NodeType::KLEENE_STAR:
+      case NodeType::ONE_OR_MORE: {
+        sets inner = f(left, f);
+        inner.last.for_each(
+            [&](size_t p) { result.follow[p].insert_all(inner.first); });
+        inner.nullable = inner.nullable || type == NodeType::KLEENE_STAR;
+        return inner;
+      }
+      case NodeType::OPTIONAL: {
+        sets inner = f(left, f);
+        inner.nullable = true;
+        return inner;
+      }
+      default:
+        result.valid = false;
+        return {false, StateBitset{n + 1}, StateBitset{n + 1}};
+    }
+  };
+  sets root = visit(parsed.first_node, visit);
+  result.nullable = root.nullable;
+  result.first = std::move(root.first);
+  result.last = std::move(root.last);
+  result.follow[0] = result.first;
+  return result;
+}
+
+/**
+ * Build the Glushkov NFA of a parse tree: one state per position plus the
+ * start state, with no epsilon transitions between them.
+ *
+ * The NFA type has a single final state, so one accepting state with no
+ * out-edges is added: every edge into a last position is mirrored into it.
+ * Its only epsilon edge comes from the start state, for nullable regexes.
+ *
+ * Fails with TOO_LARGE past `PositionAutomaton::max_follow_bits` or
+ * `max_follow_pairs`, as the edges grow with the square of the positions.
+ */
+inline NFA create_glushkov(Parser::ParseResult&& parsed) {
+  const PositionAutomaton positions = create_positions(parsed);
+  const auto failed = [](NFA::err_state error) {
+    NFA result{0, {0, 0}};
+    result.error = error;
+    return result;
+  };
+  if (positions.too_large) [[unlikely]] {
+    return failed(NFA::err_state::TOO_LARGE);
+  }
+  if (!positions.valid) [[unlikely]] {
+    return failed(NFA::err_state::BAD_PARSE);
+  }
+  const size_t n = positions.position_count();
+  size_t pairs = 0;
+  for (const StateBitset& follow : positions.follow) {
+    pairs += follow.count();
+  }
+  if (pairs > PositionAutomaton::max_follow_pairs) [[unlikely]] {
+    return failed(NFA::err_state::TOO_LARGE);
+  }
+  const NFA::state final_state = n + 1;
+  NFA result{n + 2, {0, final_state}};
+
+  for (NFA::state p = 0; p <= n; ++p) {
+    // The bytes that already lead from `p` to the final state.
+    ByteSet to_final;
+    positions.follow[p].for_each([&](size_t q) {
+      const ByteSet& label = positions.labels[q];
+      result.add_transition({p, q}, label);
+      if (positions.last.contains(q)) {
+        result.add_transition({p, final_state}, label.minus(to_final));
+        to_final.insert_all(label);
+      }
+    });
+  }
+  if (positions.nullable) {
+    result.add_transition({0, final_state},
+                          static_cast<char>(NFA::input::EPS));
+  }
+  result.compute_closures();
+  return result;
+}
+
+}  // namespace RM::Impl
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace RM::Impl {
+
+/** Any multi-pass range of chars, read in place: std::string_view,
+ * std::span<const char>, std::deque<char>, a view over another range...
+ * Character arrays are left out, since string literals would bring their
+ * terminating '\0' along; they are matched as std::string_view.
+ */
+template <typename R>
+concept CharRange =
+    std::ranges::forward_range<R> &&
+    !std::is_array_v<std::remove_cvref_t<R>> &&
+    std::same_as<std::ranges::range_value_t<R>, char>;
+
+/** A multi-pass range of contiguous chunks that are read one after the
+ * other as a single input, like the segments of a rope or the buffers of an
+ * iovec array turned into std::string_views.
+ */
+template <typename R>
+concept ChunkedInput =
+    std::ranges::forward_range<R> && !CharRange<R> &&
+    std::convertible_to<std::ranges::range_reference_t<R>, std::string_view>;
+
+template <CharRange R>
+bool starts_with(R&& input, std::string_view prefix) {
+  auto it = std::ranges::begin(input);
+  const auto end = std::ranges::end(input);
+  for (const char c : prefix) {
+    if (it == end || *it != c) {
+      return false;
+    }
+    ++it;
+  }
+  return true;
+}
+
+/** The chars of all the chunks of a ChunkedInput in order, as one
+ * CharRange that refers to the chunks instead of copying them.
+ * std::views::join would do, but it only gives an input range when the
+ * chunks are converted to std::string_view on the fly.
+ */
+template <ChunkedInput R>
+class JoinedChunks {
+ public:
+  class iterator {
+   public:
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    iterator(std::ranges::iterator_t<const R> first,
+             std::ranges::sentinel_t<const R> last)
+        : outer{std::move(first)}, outer_end{std::move(last)} {
+      skip_empty();
+    }
+
+    const char& operator*() const { return chunk[pos]; }
+    iterator& operator++() {
+      if (++pos == chunk.size()) {
+        ++outer;
+        skip_empty();
+      }
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const iterator& other) const {
+      return outer == other.outer && pos == other.pos;
+    }
+    bool operator==(std::default_sentinel_t /*unused*/) const {
+      return outer == outer_end;
+    }
+
+   private:
+    // Load the chunk at `outer`, or the next non-empty one.
+    void skip_empty() {
+      pos = 0;
+      for (; outer != outer_end; ++outer) {
+        chunk = std::string_view{*outer};
+        if (!chunk.empty()) {
+          return;
+        }
+      }
+    }
+
+    std::ranges::iterator_t<const R> outer{};
+    std::ranges::sentinel_t<const R> outer_end{};
+    std::string_view chunk;
+    size_t pos = 0;
+  };
+
+  explicit JoinedChunks(const R& chunks) : input{&chunks} {}
+
+  iterator begin() const {
+    return {std::ranges::begin(*input), std::ranges::end(*input)};
+  }
+  std::default_sentinel_t end() const { return {}; }
+
+ private:
+  const R* input;
+};
+
+}  // namespace RM::Impl
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <ranges>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "input.hpp"
+#include "nfa.hpp"
+#include "state_bitset.hpp"
+#include "stats.hpp"
+
+namespace RM::Impl {
+
+/** A DFA built on demand from an NFA during matching.
+ *
+ * Every distinct set of NFA states reached while matching is interned as a
+ * DFA state, and the transition out of it on each byte class of the NFA is
+ * memoized the first time it is taken. Once the states and transitions used
+ * by an input are cached, matching it again costs one table lookup per byte.
+ *
+ * The cache is bounded by `cache_limit` bytes. When a new DFA state would not
+ * fit, the cache is either cleared and rebuilt from the current state, or the
+ * rest of the input is matched by plain NFA simulation.
+ *
+ * The NFA is passed to `match` instead of being stored, so that the owner can
+ * be moved freely. It must be the same NFA on every call.
+ */
+class LazyDFA {
+ public:
+  using dstate = std::uint32_t;
+  enum class overflow : char { CLEAR, FALLBACK };
+
+  static constexpr dstate UNKNOWN = std::numeric_limits<dstate>::max();
+  static constexpr dstate DEAD = 0;
+
+  explicit LazyDFA(size_t limit = default_cache_limit,
+                   overflow policy = overflow::CLEAR)
+      : cache_limit{limit}, on_overflow{policy} {}
+
+  bool match(const NFA& nfa, std::string_view s) {
+    NoStats none;
+    return match(nfa, s, none);
+  }
+
+  template <CharRange R, typename Stats>
+  bool match(const NFA& nfa, R&& s, Stats& stats) {
+    dstate current = start_state(nfa, stats);
+    const auto end = std::ranges::end(s);
+    for (auto it = std::ranges::begin(s); it != end; ++it) {
+      const dstate to = next(nfa, current, *it, stats);
+      if (to == UNKNOWN) [[unlikely]] {
+        return nfa_fallback(nfa, sets[current], it, end, stats);
+      }
+      stats.read(1);
+      if constexpr (Stats::enabled) {
+        stats.active(sets[to].count());
+      }
+      if (to == DEAD) {
+        return false;
+      }
+      current = to;
+    }
+    return accepting[current];
+  }
+
+  dstate start_state(const NFA& nfa) {
+    NoStats none;
+    return start_state(nfa, none);
+  }
+
+  template <typename Stats>
+  dstate start_state(const NFA& nfa, Stats& stats) {
+    if (sets.empty()) {
+      reset(nfa, stats);
+    }
+    return start;
+  }
+
+  /**
+   * The state reached from `from` on `c`, computed if not cached yet.
+   * `from` is renumbered if the cache is cleared on the way. Returns UNKNOWN
+   * if the target does not fit and the overflow policy is FALLBACK.
+   */
+  dstate next(const NFA& nfa, dstate& from, char c) {
+    NoStats none;
+    return next(nfa, from, c, none);
+  }
+
+  template <typename Stats>
+  dstate next(const NFA& nfa, dstate& from, char c, Stats& stats) {
+    const dstate to = table[from * columns + nfa.byte_classes.of(c)];
+    if (to != UNKNOWN) [[likely]] {
+      stats.cache_hit();
+      return to;
+    }
+    stats.cache_miss();
+    return compute(nfa, from, c, stats);
+  }
+
+  bool is_accepting(dstate s) const { return accepting[s]; }
+  const StateBitset& states_of(dstate s) const { return sets[s]; }
+
+  size_t state_count() const { return sets.size(); }
+  size_t memory_used() const { return used; }
+  size_t clear_count() const { return clears; }
+
+  static constexpr size_t default_cache_limit = size_t{1} << 20;
+
+ private:
+  template <typename Stats>
+  void reset(const NFA& nfa, Stats& stats) {
+    sets.clear();
+    accepting.clear();
+    table.clear();
+    index.clear();
+    used = 0;
+    columns = nfa.byte_classes.size();
+    stack.reserve(nfa.size);
+    scratch = StateBitset{nfa.size};
+
+    intern(nfa, StateBitset{nfa.size}, stats);
+    StateBitset initial{nfa.size};
+    nfa.add_closure(initial, nfa.initial_state, stack, stats);
+    start = intern(nfa, std::move(initial), stats);
+  }
+
+  size_t state_bytes(const NFA& nfa) const {
+    const size_t set_bytes =
+        sizeof(StateBitset::word) * ((nfa.size + StateBitset::word_bits - 1) /
+                                     StateBitset::word_bits);
+    // The set is stored both in `sets` and as the key of `index`.
+    return columns * sizeof(dstate) + 2 * set_bytes + sizeof(bool) +
+           sizeof(StateBitset) + map_node_overhead;
+  }
+
+  template <typename Stats>
+  dstate intern(const NFA& nfa, StateBitset&& set, Stats& stats) {
+    if (const auto it = index.find(set.words); it != index.end()) {
+      return it->second;
+    }
+    const auto id = static_cast<dstate>(sets.size());
+    index.emplace(set.words, id);
+    accepting.push_back(set.contains(nfa.final_state));
+    sets.push_back(std::move(set));
+    table.resize(table.size() + columns, UNKNOWN);
+    // The set, its copy in `index` and the table row.
+    stats.allocated(3);
+    used += state_bytes(nfa);
+    return id;
+  }
+
+  /**
+   * Compute and memoize the transition out of `from` on `c`.
+   * Returns UNKNOWN when the target is a new state that does not fit into the
+   * cache and the overflow policy is FALLBACK.
+   */
+  template <typename Stats>
+  dstate compute(const NFA& nfa, dstate& from, char c, Stats& stats) {
+    nfa.step(sets[from], c, scratch, stack, stats);
+    if (const auto it = index.find(scratch.words); it != index.end()) {
+      table[from * columns + nfa.byte_classes.of(c)] = it->second;
+      return it->second;
+    }
+    if (used + state_bytes(nfa) > cache_limit) {
+      // The cache needs room for the dead, start and current states to make
+      // progress after being cleared.
+      if (on_overflow == overflow::FALLBACK ||
+          4 * state_bytes(nfa) > cache_limit) {
+        return UNKNOWN;
+      }
+      StateBitset target = std::move(scratch);
+      StateBitset source = std::move(sets[from]);
+      reset(nfa, stats);
+      ++clears;
+      from = intern(nfa, std::move(source), stats);
+      scratch = std::move(target);
+    }
+    const dstate to = intern(nfa, std::move(scratch), stats);
+    scratch = StateBitset{nfa.size};
+    stats.allocated(1);
+    table[from * columns + nfa.byte_classes.of(c)] = to;
+    return to;
+  }
+
+  // Match the rest of the input, [it, end), by NFA simulation.
+  template <typename Iterator, typename Sentinel, typename Stats>
+  bool nfa_fallback(const NFA& nfa, const StateBitset& from, Iterator it,
+                    Sentinel end, Stats& stats) {
+    StateBitset current = from;
+    StateBitset next{nfa.size};
+    stats.allocated(2);
+    for (; it != end; ++it) {
+      stats.read(1);
+      nfa.step(current, *it, next, stack, stats);
+      if constexpr (Stats::enabled) {
+        stats.active(next.count());
+      }
+      if (next.empty()) {
+        return false;
+      }
+      std::swap(current, next);
+    }
+    return current.contains(nfa.final_state);
+  }
+
+  static constexpr size_t map_node_overhead = 64;
+
+  size_t cache_limit;
+  overflow on_overflow;
+  std::vector<StateBitset> sets;
+  std::vector<bool> accepting;
+  // One entry per byte class of the NFA in every row.
+  std::vector<dstate> table;
+  size_t columns = 0;
+  std::unordered_map<std::vector<StateBitset::word>, dstate, words_hash> index;
+  std::vector<NFA::state> stack;
+  StateBitset scratch;
+  dstate start = DEAD;
+  size_t used = 0;
+  size_t clears = 0;
+};
+
+}  // namespace RM::Impl
@@ -2,11 +2,18 @@
 
 #include <concepts>
 #include <iostream>
+#include <span>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_set>
 #include <vector>
 
+#include "byte_classes.hpp"
+#include "byte_set.hpp"
+#include "input.hpp"
 #include "parser.hpp"
+#include "state_bitset.hpp"
+#include "stats.hpp"
 
 namespace RM::Impl {
 
@@ -15,7 +22,23 @@ class NFA {
   using state = size_t;
   using state_pair = std::pair<state, state>;
   using state_set = std::unordered_set<state>;
-  using trans_vec = std::vector<std::vector<char>>;
+  // Labeled out-edge of a state, reading the bytes from `input` to `last`
+  // (as unsigned, both included). Epsilon edges are kept apart, see below.
+  struct edge {
+    state to;
+    char input;
+    char last = input;
+    bool reads(char c) const {
+      const auto byte = static_cast<unsigned char>(c);
+      return static_cast<unsigned char>(input) <= byte &&
+             byte <= static_cast<unsigned char>(last);
+    }
+    bool operator==(const edge&) const = default;
+  };
+  // Per-state out-edge lists, so memory and per-byte work grow with the edge
+  // count instead of size * size.
+  using trans_vec = std::vector<std::vector<edge>>;
+  using eps_vec = std::vector<std::vector<state>>;
   enum class input : char { EPS = -1, NONE = 0 };
   enum class err_state : char {
     OK = 0,
@@ -23,7 +46,8 @@ class NFA {
     BAD_INIT,
     BAD_FINAL,
     BAD_FROM,
-    BAD_TO
+    BAD_TO,
+    TOO_LARGE
   };
 
   explicit NFA(size_t nfa_size, state_pair start_and_end)
@@ -37,7 +61,8 @@ class NFA {
       error = err_state::BAD_FINAL;
       return;
     }
-    transitions = trans_vec(size, std::vector<char>(size, '\0'));
+    transitions = trans_vec(size);
+    eps_transitions = eps_vec(size);
   }
 
   void add_transition(state_pair from_to, char input_char) {
@@ -49,61 +74,180 @@ class NFA {
       error = err_state::BAD_TO;
       return;
     }
-    transitions[from][to] = input_char;
-    if (static_cast<input>(input_char) != input::EPS) {
-      inputs.insert(input_char);
+    closure_offsets.clear();
+    if (static_cast<input>(input_char) == input::EPS) {
+      eps_transitions[from].push_back(to);
+      return;
+    }
+    transitions[from].push_back({.to = to, .input = input_char});
+    byte_classes.add(input_char);
+  }
+
+  /**
+   * Add an edge reading any byte of `bytes`, one per run of consecutive
+   * bytes, so that a class like "[a-z0-9]" costs two edges. No byte of the
+   * set is taken as epsilon.
+   */
+  void add_transition(state_pair from_to, const ByteSet& bytes) {
+    const auto [from, to] = from_to;
+    if (from >= size) [[unlikely]] {
+      error = err_state::BAD_FROM;
+      return;
+    } else if (to >= size) [[unlikely]] {
+      error = err_state::BAD_TO;
+      return;
     }
+    closure_offsets.clear();
+    bytes.for_each_range([&](char first, char last) {
+      transitions[from].push_back({.to = to, .input = first, .last = last});
+      byte_classes.add_range(first, last);
+    });
   }
 
+  /**
+   * Merge the edges of `other` into this NFA, state by state.
+   *
+   * States keep their numbers, so `other` must not be larger than this NFA.
+   */
   void fill_states_from(const NFA& other) {
+    closure_offsets.clear();
     for (state i = 0; i < other.size; ++i) {
-      for (state j = 0; j < other.size; ++j) {
-        transitions[i][j] = other.transitions[i][j];
+      transitions[i].insert(transitions[i].end(), other.transitions[i].begin(),
+                            other.transitions[i].end());
+      eps_transitions[i].insert(eps_transitions[i].end(),
+                                other.eps_transitions[i].begin(),
+                                other.eps_transitions[i].end());
+      for (const edge& e : other.transitions[i]) {
+        byte_classes.add_range(e.input, e.last);
       }
     }
-    for (const char in : other.inputs) {
-      inputs.insert(in);
-    }
   }
 
   void shift_states(size_t n) {
     if (n == 0) {
       return;
     }
-    const size_t new_size = size + n;
-
-    trans_vec new_transitions(new_size, std::vector<char>(new_size, '\0'));
-    for (state i = 0; i < size; ++i) {
-      for (state j = 0; j < size; ++j) {
-        new_transitions[i + n][j + n] = transitions[i][j];
+    closure_offsets.clear();
+    for (auto& edges : transitions) {
+      for (edge& e : edges) {
+        e.to += n;
+      }
+    }
+    for (auto& targets : eps_transitions) {
+      for (state& to : targets) {
+        to += n;
       }
     }
+    transitions.insert(transitions.begin(), n, {});
+    eps_transitions.insert(eps_transitions.begin(), n, {});
 
-    size = new_size;
+    size += n;
     initial_state += n;
     final_state += n;
-    transitions = new_transitions;
   }
 
   void push_empty_state() {
-    for (state i = 0; i < size; ++i) {
-      transitions[i].push_back('\0');
-    }
-    transitions.emplace_back(++size, '\0');
+    closure_offsets.clear();
+    transitions.emplace_back();
+    eps_transitions.emplace_back();
+    ++size;
   }
 
   state_set get_reachable_states(const state_set& states, char c) const {
     std::unordered_set<state> result;
     for (const state s : states) {
-      for (size_t i = 0; i < transitions[s].size(); ++i) {
-        if (transitions[s][i] == c) {
-          result.insert(i);
+      for (const edge& e : transitions[s]) {
+        if (e.reads(c)) {
+          result.insert(e.to);
         }
       }
     }
     return result;
   }
 
+  /**
+   * Precompute the epsilon-closure of every state.
+   *
+   * The closure of state `s` is stored as the slice
+   * `closures[closure_offsets[s] .. closure_offsets[s + 1])`, so the per-byte
+   * step of a match becomes a union of slices with no graph traversal.
+   * Any later change to the NFA drops the precomputed closures.
+   *
+   * Long chains of nullable nodes, like "((a?){1000}){20}", give closures
+   * that hold size * size states in total. Past `closure_budget` states none
+   * are kept, and matching follows the epsilon edges instead.
+   */
+  void compute_closures() {
+    closure_offsets.assign(size + 1, 0);
+    closures.clear();
+    std::vector<size_t> visited(size, size);
+    std::vector<state> stack;
+    for (state s = 0; s < size; ++s) {
+      closure_offsets[s] = closures.size();
+      visited[s] = s;
+      closures.push_back(s);
+      stack.push_back(s);
+      while (!stack.empty()) {
+        const state top = stack.back();
+        stack.pop_back();
+        for (const state to : eps_transitions[top]) {
+          if (visited[to] != s) {
+            visited[to] = s;
+            closures.push_back(to);
+            stack.push_back(to);
+          }
+        }
+      }
+      if (closures.size() > closure_budget) [[unlikely]] {
+        closure_offsets.clear();
+        closures = {};
+        return;
+      }
+    }
+    closure_offsets[size] = closures.size();
+  }
+
+  // The most states `compute_closures` stores, 32 MiB of them.
+  static constexpr size_t closure_budget = size_t{1} << 22;
+
+  bool has_closures() const { return closure_offsets.size() == size + 1; }
+
+  std::span<const state> closure_of(state s) const {
+    return {closures.data() + closure_offsets[s],
+            closure_offsets[s + 1] - closure_offsets[s]};
+  }
+
+  /**
+   * Call `f` on the states of the epsilon-closure of `s`, `s` included.
+   *
+   * With precomputed closures, `f` sees every state of the closure once.
+   * Otherwise the epsilon edges are followed from the states `f` returns
+   * true for, so a caller that already has the closure of a state returns
+   * false for it and skips that part of the graph. `stack` is scratch space.
+   */
+  template <typename F>
+  void for_each_in_closure(state s, std::vector<state>& stack, F&& f) const {
+    if (has_closures()) {
+      for (const state to : closure_of(s)) {
+        f(to);
+      }
+      return;
+    }
+    if (!f(s)) {
+      return;
+    }
+    stack.push_back(s);
+    while (!stack.empty()) {
+      const state top = stack.back();
+      stack.pop_back();
+      for (const state to : eps_transitions[top]) {
+        if (f(to)) {
+          stack.push_back(to);
+        }
+      }
+    }
+  }
+
   /**
    * Compute the epsilon-closure of a set of NFA states.
    *
@@ -115,6 +259,14 @@ class NFA {
     if (states.empty()) {
       return {};
     }
+    if (has_closures()) {
+      state_set result;
+      for (const state s : states) {
+        const auto closure = closure_of(s);
+        result.insert(closure.begin(), closure.end());
+      }
+      return result;
+    }
     std::vector<state> stack(states.begin(), states.end());
     state_set result(states.begin(), states.end());
 
@@ -122,14 +274,10 @@ class NFA {
       const state s = stack.back();
       stack.pop_back();
 
-      for (size_t i = 0; i < transitions[s].size(); ++i) {
-        const char c = transitions[s][i];
-        if (c != static_cast<char>(input::EPS)) {
-          continue;
-        }
-        if (!result.contains(i)) {
-          result.emplace(i);
-          stack.push_back(i);
+      for (const state to : eps_transitions[s]) {
+        if (!result.contains(to)) {
+          result.emplace(to);
+          stack.push_back(to);
         }
       }
     }
@@ -137,13 +285,27 @@ class NFA {
     return result;
   }
 
-  bool match(const std::string& s) const {
+  bool match(std::string_view s) const {
+    NoStats none;
+    return match(s, none);
+  }
+
+  template <CharRange R, typename Stats>
+  bool match(R&& s, Stats& stats) const {
     state_set reachable = eps_closure({initial_state});
+    stats.allocated(2);
+    stats.closure(1);
     for (const char c : s) {
-      if (!inputs.contains(c)) {
+      stats.read(1);
+      if (!byte_classes.reads(c)) {
         return false;
       }
-      reachable = eps_closure(get_reachable_states(reachable, c));
+      state_set next = get_reachable_states(reachable, c);
+      // The reachable states and their closure are new sets.
+      stats.allocated(2);
+      stats.closure(next.size());
+      reachable = eps_closure(std::move(next));
+      stats.active(reachable.size());
       if (reachable.empty()) {
         return false;
       }
@@ -151,8 +313,112 @@ class NFA {
     return reachable.contains(final_state);
   }
 
-  std::vector<std::vector<char>> transitions;
-  std::unordered_set<char> inputs;
+  /**
+   * Add `s` and its epsilon-closure to `states`.
+   *
+   * `stack` is scratch space; reserving `size` elements up front is enough
+   * for it to never reallocate, as each state is pushed at most once.
+   */
+  void add_closure(StateBitset& states, state s,
+                   std::vector<state>& stack) const {
+    NoStats none;
+    add_closure(states, s, stack, none);
+  }
+
+  template <typename Stats>
+  void add_closure(StateBitset& states, state s, std::vector<state>& stack,
+                   Stats& stats) const {
+    // `states` only ever holds whole closures, so the closure of a state it
+    // already contains is in there too.
+    if (states.contains(s)) {
+      return;
+    }
+    stats.closure(1);
+    if (has_closures()) {
+      for (const state to : closure_of(s)) {
+        states.insert(to);
+      }
+      return;
+    }
+    states.insert(s);
+    stack.push_back(s);
+    while (!stack.empty()) {
+      const state top = stack.back();
+      stack.pop_back();
+      for (const state to : eps_transitions[top]) {
+        if (!states.contains(to)) {
+          states.insert(to);
+          stack.push_back(to);
+        }
+      }
+    }
+  }
+
+  /**
+   * Compute the states reachable from `from` by reading `c`, including their
+   * epsilon-closure, into `to`. `to` is cleared first.
+   */
+  void step(const StateBitset& from, char c, StateBitset& to,
+            std::vector<state>& stack) const {
+    NoStats none;
+    step(from, c, to, stack, none);
+  }
+
+  template <typename Stats>
+  void step(const StateBitset& from, char c, StateBitset& to,
+            std::vector<state>& stack, Stats& stats) const {
+    to.clear();
+    from.for_each([&](state s) {
+      for (const edge& e : transitions[s]) {
+        if (e.reads(c)) {
+          add_closure(to, e.to, stack, stats);
+        }
+      }
+    });
+  }
+
+  /**
+   * Same as `match`, but the active sets are two preallocated bitsets that
+   * are swapped after every byte, so nothing is allocated past the setup.
+   */
+  bool match_bitset(std::string_view s) const {
+    NoStats none;
+    return match_bitset(s, none);
+  }
+
+  template <CharRange R, typename Stats>
+  bool match_bitset(R&& s, Stats& stats) const {
+    StateBitset current{size};
+    StateBitset next{size};
+    std::vector<state> stack;
+    stack.reserve(size);
+    stats.allocated(3);
+
+    add_closure(current, initial_state, stack, stats);
+    for (const char c : s) {
+      stats.read(1);
+      if (!byte_classes.reads(c)) {
+        return false;
+      }
+      step(current, c, next, stack, stats);
+      if constexpr (Stats::enabled) {
+        stats.active(next.count());
+      }
+      if (next.empty()) {
+        return false;
+      }
+      std::swap(current, next);
+    }
+    return current.contains(final_state);
+  }
+
+  trans_vec transitions;
+  eps_vec eps_transitions;
+  std::vector<size_t> closure_offsets;
+  std::vector<state> closures;
+  // Bytes no edge tells apart share a class, and a byte no edge reads at all
+  // cannot be matched.
+  ByteClasses byte_classes;
   size_t size{};
   state initial_state{};
   state final_state{};
@@ -1,11 +1,17 @@
 #pragma once
 
+#include "glushkov.hpp"
 #include "nfa.hpp"
 
 namespace RM::Impl {
 
 constexpr char EPS = static_cast<char>(NFA::input::EPS);
 
+// How an NFA is built from a parse tree: Thompson's construction, with about
+// two states and a few epsilon edges per operator, or Glushkov's position
+// automaton, with one state per character and no epsilon edges.
+enum class construction : char { THOMPSON, GLUSHKOV };
+
 inline NFA create_err(NFA::err_state error) {
   NFA result{0, {0, 0}};
   result.error = error;
@@ -18,6 +24,12 @@ inline NFA create_basic(char input) {
   return result;
 }
 
+inline NFA create_class(const ByteSet& bytes) {
+  NFA result(2, {0, 1});
+  result.add_transition({0, 1}, bytes);
+  return result;
+}
+
 inline NFA create_concat(NFA&& nfa1, NFA&& nfa2) {
   nfa2.shift_states(nfa1.size - 1);
   NFA result{nfa2};
@@ -38,10 +50,12 @@ inline NFA create_kleene_star(NFA&& nfa) {
   return nfa;
 }
 
+// The loop goes back from the old final state, so that the new one has no
+// out-edges and stays safe to merge with the next state in `create_concat`.
 inline NFA create_one_or_more(NFA&& nfa) {
   nfa.push_empty_state();
   nfa.add_transition({nfa.final_state, nfa.size - 1}, EPS);
-  nfa.add_transition({nfa.size - 1, nfa.initial_state}, EPS);
+  nfa.add_transition({nfa.final_state, nfa.initial_state}, EPS);
   nfa.final_state = nfa.size - 1;
   return nfa;
 }
@@ -73,46 +87,158 @@ inline NFA create_or(NFA&& nfa1, NFA&& nfa2) {
   return result;
 }
 
-inline NFA create_from_parse(Parser::ParseResult&& parsed) {
-  if (!parsed.err_msg.empty()) [[unlikely]] {
-    return create_err(NFA::err_state::BAD_PARSE);
+/**
+ * Count the states of the Thompson NFA of every subtree of a parse tree.
+ *
+ * Every sub-automaton built by the `create_*` functions above starts at its
+ * first state and ends at its last one, so its size only depends on its
+ * subtree. Knowing the sizes up front gives every subtree its final state
+ * ids before any state is emitted. Returns an empty vector for an unknown
+ * node type.
+ */
+inline std::vector<size_t> thompson_sizes(const Parser::ParseResult& parsed) {
+  using NodeType = ParseNode::NodeType;
+  const std::vector<ParseNode>& nodes = parsed.nodes;
+  std::vector<size_t> sizes(nodes.size(), 0);
+  bool valid = true;
+  const auto count_states = [&](ParseNode::index i, auto& f) -> size_t {
+    const auto [left, right, type, character, set] =
+        nodes[static_cast<size_t>(i)];
+    size_t n = 0;
+    switch (type) {
+      case NodeType::CHAR:
+      case NodeType::CLASS:
+        n = 2;
+        break;
+      case NodeType::OR:
+        n = f(left, f) + f(right, f) + 2;
+        break;
+      case NodeType::CONCAT:
+        n = f(left, f) + f(right, f) - 1;
+        break;
+      case NodeType::KLEENE_STAR:
+      case NodeType::OPTIONAL:
+        n = f(left, f) + 2;
+        break;
+      case NodeType::ONE_OR_MORE:
+        n = f(left, f) + 1;
+        break;
+      default:
+        valid = false;
+        break;
+    }
+    sizes[static_cast<size_t>(i)] = n;
+    return n;
+  };
+  count_states(parsed.first_node, count_states);
+  if (!valid) [[unlikely]] {
+    return {};
   }
+  return sizes;
+}
 
-  const auto recursive_build = [&](ParseNode::index i, auto& f) -> NFA {
-    const ParseNode node = parsed.nodes[static_cast<size_t>(i)];
-    const auto [left, right, type, character] = node;
+/**
+ * Emit the Thompson NFA of a parse tree into `result`, starting at state
+ * `first`, with the sizes from `thompson_sizes`. No state is renumbered or
+ * copied, so this is linear in the tree size.
+ */
+inline void emit_thompson(NFA& result, const Parser::ParseResult& parsed,
+                          const std::vector<size_t>& sizes,
+                          NFA::state first) {
+  using NodeType = ParseNode::NodeType;
+  const std::vector<ParseNode>& nodes = parsed.nodes;
+  const auto emit = [&](ParseNode::index i, NFA::state first_state,
+                        auto& f) -> void {
+    const auto [left, right, type, character, set] =
+        nodes[static_cast<size_t>(i)];
+    const NFA::state last = first_state + sizes[static_cast<size_t>(i)] - 1;
+    const size_t left_size =
+        left == -1 ? 0 : sizes[static_cast<size_t>(left)];
 
     switch (type) {
-      case ParseNode::NodeType::CHAR:
-        return create_basic(character);
-      case ParseNode::NodeType::OR:
-        return create_or(f(left, f), f(right, f));
-      case ParseNode::NodeType::CONCAT:
-        return create_concat(f(left, f), f(right, f));
-      case ParseNode::NodeType::KLEENE_STAR:
-        return create_kleene_star(f(left, f));
-      case ParseNode::NodeType::ONE_OR_MORE:
-        return create_one_or_more(f(left, f));
-      case ParseNode::NodeType::OPTIONAL:
-        return create_optional(f(left, f));
-      default:
-        return create_err(NFA::err_state::BAD_PARSE);
+      case NodeType::CHAR:
+        result.add_transition({first_state, last}, character);
+        break;
+      case NodeType::CLASS:
+        result.add_transition({first_state, last},
+                              parsed.sets[static_cast<size_t>(set)]);
+        break;
+      case NodeType::OR:
+        f(left, first_state + 1, f);
+        f(right, first_state + 1 + left_size, f);
+        result.add_transition({first_state, first_state + 1}, EPS);
+        result.add_transition({first_state, first_state + 1 + left_size}, EPS);
+        result.add_transition({first_state + left_size, last}, EPS);
+        result.add_transition({last - 1, last}, EPS);
+        break;
+      case NodeType::CONCAT:
+        f(left, first_state, f);
+        f(right, first_state + left_size - 1, f);
+        break;
+      case NodeType::KLEENE_STAR:
+        f(left, first_state + 1, f);
+        result.add_transition({first_state, first_state + 1}, EPS);
+        result.add_transition({first_state, last}, EPS);
+        result.add_transition({last - 1, first_state + 1}, EPS);
+        result.add_transition({last - 1, last}, EPS);
+        break;
+      case NodeType::ONE_OR_MORE:
+        f(left, first_state, f);
+        result.add_transition({last - 1, last}, EPS);
+        result.add_transition({last - 1, first_state}, EPS);
+        break;
+      case NodeType::OPTIONAL:
+        f(left, first_state + 1, f);
+        result.add_transition({first_state, first_state + 1}, EPS);
+        result.add_transition({first_state, last}, EPS);
+        result.add_transition({last - 1, last}, EPS);
+        break;
     }
   };
+  emit(parsed.first_node, first, emit);
+}
 
-  return recursive_build(parsed.first_node, recursive_build);
+/**
+ * Build the Thompson NFA of a parse tree in a single pass into one NFA.
+ * The numbering matches what composing the `create_*` functions would give.
+ */
+inline NFA create_from_parse(Parser::ParseResult&& parsed) {
+  if (!parsed.err_msg.empty()) [[unlikely]] {
+    return create_err(NFA::err_state::BAD_PARSE);
+  }
+  const std::vector<size_t> sizes = thompson_sizes(parsed);
+  if (sizes.empty()) [[unlikely]] {
+    return create_err(NFA::err_state::BAD_PARSE);
+  }
+  const size_t total = sizes[static_cast<size_t>(parsed.first_node)];
+  NFA result{total, {0, total - 1}};
+  emit_thompson(result, parsed, sizes, 0);
+  if (result.error == NFA::err_state::OK) {
+    result.compute_closures();
+  }
+  return result;
 }
 
-inline NFA create_from_str(std::string&& str, std::string& err_msg) {
-  Parser::ParseResult parsed = Impl::Parser{str}.parse();
+inline NFA create_nfa(Parser::ParseResult&& parsed, std::string& err_msg,
+                      construction mode = construction::THOMPSON) {
   if (!parsed.err_msg.empty()) {
     err_msg = parsed.err_msg;
   }
-  Impl::NFA result = Impl::create_from_parse(std::move(parsed));
+  Impl::NFA result = mode == construction::GLUSHKOV
+                         ? Impl::create_glushkov(std::move(parsed))
+                         : Impl::create_from_parse(std::move(parsed));
+  if (result.error == Impl::NFA::err_state::TOO_LARGE && err_msg.empty()) {
+    err_msg = "too many follow positions for the Glushkov construction";
+  }
   if (result.error != Impl::NFA::err_state::OK && err_msg.empty()) {
     err_msg = std::to_string(static_cast<int>(result.error));
   }
   return result;
 }
 
+inline NFA create_from_str(std::string&& str, std::string& err_msg,
+                           construction mode = construction::THOMPSON) {
+  return create_nfa(Impl::Parser{str}.parse(), err_msg, mode);
+}
+
 }  // namespace RM::Impl
\ No newline at end of file
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bitap.hpp"
+#include "dfa.hpp"
+
+namespace RM::Impl {
+
+namespace ParallelImpl {
+
+constexpr size_t NONE = std::numeric_limits<size_t>::max();
+constexpr size_t block_size = 256;
+
+// The indices a worker has left to process, which other workers steal from.
+struct WorkRange {
+  std::mutex lock;
+  size_t begin = 0;
+  size_t end = 0;
+};
+
+inline size_t resolve_threads(size_t threads) {
+  return threads == 0 ? std::max(1U, std::thread::hardware_concurrency())
+                      : threads;
+}
+
+/**
+ * Run `chunk` from every state of `starts` at once and return the state each
+ * of them ends in.
+ *
+ * Every distinct state is one lane. Lanes that meet follow the same path
+ * from then on, so they are merged after every block of input, and lanes
+ * that reach `dead` are dropped. Most automata forget where they started
+ * within a few bytes, so the work soon drops to a few lanes. The result is
+ * unspecified once `stop` is set.
+ */
+template <typename State, typename Step>
+std::vector<State> run_from_all(const std::vector<State>& starts,
+                                std::string_view chunk, State dead,
+                                Step step, const std::atomic<bool>& stop) {
+  std::vector<State> lanes = starts;
+  std::vector<size_t> lane_of(starts.size());
+  for (size_t i = 0; i < starts.size(); ++i) {
+    lane_of[i] = i;
+  }
+  std::vector<std::pair<State, size_t>> order;
+  std::vector<size_t> remap;
+
+  const auto merge = [&]() {
+    order.clear();
+    for (size_t i = 0; i < lanes.size(); ++i) {
+      order.emplace_back(lanes[i], i);
+    }
+    std::sort(order.begin(), order.end());
+    remap.assign(lanes.size(), NONE);
+    lanes.clear();
+    for (size_t i = 0; i < order.size(); ++i) {
+      const auto [lane_state, old] = order[i];
+      if (lane_state == dead) {
+        continue;
+      }
+      if (i == 0 || order[i - 1].first != lane_state) {
+        lanes.push_back(lane_state);
+      }
+      remap[old] = lanes.size() - 1;
+    }
+    // Once the lanes have converged this is the common case, and it saves
+    // a pass over all the starts.
+    bool unchanged = true;
+    for (size_t i = 0; i < remap.size(); ++i) {
+      unchanged = unchanged && remap[i] == i;
+    }
+    if (unchanged) {
+      return;
+    }
+    for (size_t& lane : lane_of) {
+      lane = lane == NONE ? NONE : remap[lane];
+    }
+  };
+
+  merge();
+  for (size_t begin = 0; begin < chunk.size() && !lanes.empty();
+       begin += block_size) {
+    if (stop.load(std::memory_order_relaxed)) {
+      break;
+    }
+    const size_t end = std::min(begin + block_size, chunk.size());
+    for (size_t i = begin; i < end; ++i) {
+      for (State& lane : lanes) {
+        lane = step(lane, chunk[i]);
+      }
+    }
+    merge();
+  }
+
+  std::vector<State> result(starts.size(), dead);
+  for (size_t i = 0; i < starts.size(); ++i) {
+    if (lane_of[i] != NONE) {
+      result[i] = lanes[lane_of[i]];
+    }
+  }
+  return result;
+}
+
+/**
+ * Run `s` split into one chunk per thread and return the final state.
+ *
+ * The first chunk runs from the initial state with `run_first`, every other
+ * chunk runs from all of `starts` with `run_from_all`, and the maps of the
+ * chunks are then applied in order with `compose`. As soon as some chunk
+ * sends every state to `dead`, the whole input is known to fail and the
+ * other workers stop. Every chunk has at least `min_chunk` bytes, and at
+ * least one.
+ */
+template <typename State, typename RunFirst, typename Step,
+          typename Compose>
+State run_chunks(std::string_view s, size_t threads, size_t min_chunk,
+                 const std::vector<State>& starts, State dead,
+                 RunFirst run_first, Step step, Compose compose) {
+  const size_t chunks = std::max<size_t>(
+      1, std::min(resolve_threads(threads),
+                  s.size() / std::max<size_t>(min_chunk, 1)));
+  if (chunks == 1) {
+    return run_first(s);
+  }
+  // Chunk k is [k * size / chunks, (k + 1) * size / chunks), so every chunk
+  // is in bounds and none is empty.
+  const auto chunk = [&](size_t k) {
+    const size_t begin = k * s.size() / chunks;
+    return s.substr(begin, (k + 1) * s.size() / chunks - begin);
+  };
+
+  std::atomic<bool> stop{false};
+  std::vector<std::vector<State>> maps(chunks);
+  std::vector<std::jthread> workers;
+  workers.reserve(chunks - 1);
+  for (size_t k = 1; k < chunks; ++k) {
+    workers.emplace_back([&, k]() {
+      maps[k] = run_from_all(starts, chunk(k), dead, step, stop);
+      if (std::all_of(maps[k].begin(), maps[k].end(),
+                      [&](State to) { return to == dead; })) {
+        stop.store(true, std::memory_order_relaxed);
+      }
+    });
+  }
+  State current = run_first(chunk(0));
+  if (current == dead) {
+    stop.store(true, std::memory_order_relaxed);
+  }
+  // Joins the workers.
+  workers.clear();
+  if (stop.load(std::memory_order_relaxed)) {
+    return dead;
+  }
+  for (size_t k = 1; k < chunks; ++k) {
+    current = compose(current, maps[k]);
+  }
+  return current;
+}
+
+}  // namespace ParallelImpl
+
+constexpr size_t default_min_parallel_chunk = size_t{1} << 16;
+constexpr size_t default_batch_grain = 64;
+
+/**
+ * Call a worker on every index in [0, n), on up to `threads` threads, all
+ * cores if 0.
+ *
+ * Every thread calls `make_worker()` once and then passes each of its
+ * indices to the returned callable, so per-thread scratch state lives in the
+ * worker and is reused. The indices start split evenly between the threads,
+ * which take `grain` of them at a time from the front of their own range.
+ * A thread that runs out steals the back half of another thread's range, so
+ * uneven inputs still keep all of them busy.
+ */
+template <typename MakeWorker>
+void for_each_index(size_t n, size_t threads, MakeWorker make_worker,
+                    size_t grain = default_batch_grain) {
+  threads = std::min(ParallelImpl::resolve_threads(threads),
+                     std::max<size_t>(1, (n + grain - 1) / grain));
+  std::vector<ParallelImpl::WorkRange> ranges(threads);
+  for (size_t w = 0; w < threads; ++w) {
+    ranges[w].begin = n * w / threads;
+    ranges[w].end = n * (w + 1) / threads;
+  }
+
+  const auto take = [&](size_t w, size_t& begin, size_t& end) {
+    ParallelImpl::WorkRange& own = ranges[w];
+    const std::lock_guard<std::mutex> guard{own.lock};
+    if (own.begin == own.end) {
+      return false;
+    }
+    begin = own.begin;
+    end = std::min(own.begin + grain, own.end);
+    own.begin = end;
+    return true;
+  };
+  const auto steal = [&](size_t w) {
+    for (size_t k = 1; k < threads; ++k) {
+      ParallelImpl::WorkRange& victim = ranges[(w + k) % threads];
+      size_t begin = 0;
+      size_t end = 0;
+      {
+        const std::lock_guard<std::mutex> guard{victim.lock};
+        const size_t left = victim.end - victim.begin;
+        if (left == 0) {
+          continue;
+        }
+        begin = left <= grain ? victim.begin : victim.begin + left / 2;
+        end = victim.end;
+        victim.end = begin;
+      }
+      const std::lock_guard<std::mutex> guard{ranges[w].lock};
+      ranges[w].begin = begin;
+      ranges[w].end = end;
+      return true;
+    }
+    return false;
+  };
+  const auto run = [&](size_t w) {
+    auto worker = make_worker();
+    size_t begin = 0;
+    size_t end = 0;
+    while (take(w, begin, end) || (steal(w) && take(w, begin, end))) {
+      for (size_t i = begin; i < end; ++i) {
+        worker(i);
+      }
+    }
+  };
+
+  std::vector<std::jthread> workers;
+  workers.reserve(threads - 1);
+  for (size_t w = 1; w < threads; ++w) {
+    workers.emplace_back(run, w);
+  }
+  run(0);
+}
+
+/**
+ * Match `s` with a DFA on up to `threads` threads, all cores if 0. Each
+ * thread gets at least `min_chunk` bytes.
+ */
+inline bool match_parallel(const DFA& dfa, std::string_view s,
+                           size_t threads,
+                           size_t min_chunk = default_min_parallel_chunk) {
+  std::vector<DFA::state> starts(dfa.size);
+  for (size_t i = 0; i < dfa.size; ++i) {
+    starts[i] = static_cast<DFA::state>(i);
+  }
+  const DFA::state last = ParallelImpl::run_chunks(
+      s, threads, min_chunk, starts, dfa.dead_state,
+      [&](std::string_view chunk) {
+        DFA::state current = dfa.initial_state;
+        for (const char c : chunk) {
+          current = dfa.next(current, c);
+          if (current == dfa.dead_state) {
+            break;
+          }
+        }
+        return current;
+      },
+      [&](DFA::state from, char c) { return dfa.next(from, c); },
+      [](DFA::state from, const std::vector<DFA::state>& map) {
+        return map[from];
+      });
+  return dfa.accepting[last] != 0;
+}
+
+/**
+ * Match `s` with a Bitap on up to `threads` threads, all cores if 0.
+ * A bitap step maps a union of positions to the union of their images, so a
+ * chunk is run from every single position and the map of a set of positions
+ * is the union of their maps.
+ */
+inline bool match_parallel(const Bitap& bitap, std::string_view s,
+                           size_t threads,
+                           size_t min_chunk = default_min_parallel_chunk) {
+  if (s.empty()) {
+    return bitap.nullable;
+  }
+  std::vector<Bitap::mask> starts(Bitap::max_positions);
+  for (size_t p = 0; p < Bitap::max_positions; ++p) {
+    starts[p] = Bitap::mask{1} << p;
+  }
+  const Bitap::mask last = ParallelImpl::run_chunks(
+      s, threads, min_chunk, starts, Bitap::mask{0},
+      [&](std::string_view chunk) {
+        Bitap::mask active = 0;
+        for (size_t i = 0; i < chunk.size(); ++i) {
+          active = bitap.next(active, i == 0, chunk[i]);
+          if (active == 0) {
+            break;
+          }
+        }
+        return active;
+      },
+      [&](Bitap::mask from, char c) { return bitap.next(from, false, c); },
+      [](Bitap::mask from, const std::vector<Bitap::mask>& map) {
+        Bitap::mask result = 0;
+        for (; from != 0; from &= from - 1) {
+          result |= map[static_cast<size_t>(std::countr_zero(from))];
+        }
+        return result;
+      });
+  return (last & bitap.last) != 0;
+}
+
+}  // namespace RM::Impl
@@ -3,19 +3,22 @@
 #include <string>
 #include <vector>
 
+#include "byte_set.hpp"
 #include "scanner.hpp"
 
 namespace RM::Impl {
 
 /** A binary tree node with indices instead of pointers.
- * Describes a character or a binary/unary operator.
+ * Describes a character, a character class or a binary/unary operator.
  * When an index is meaningless (e.g. right index for unary "a*"), it's -1.
- * When a character is meaningless (so, for every operator), it's '\0'.
+ * When a character is meaningless (so, for every other node), it's '\0'.
+ * A class node reads any byte of `ParseResult::sets[set]`.
  */
 struct ParseNode {
   using index = int;
   enum class NodeType {
     CHAR,
+    CLASS,
     CONCAT,
     KLEENE_STAR,
     ONE_OR_MORE,
@@ -27,16 +30,21 @@ struct ParseNode {
   index right;
   NodeType type;
   char character;
+  index set = -1;
 };
 
 /** A Parser that accepts any regex string.
+ * It is constexpr, like the Scanner, so that patterns can be parsed at
+ * compile time.
  *
  * The EBNF-style representation of the grammar is:
  * <or> ::= <concat> ("|" <or>)?
  * <concat> ::= <repeat> ("." <concat>)?
- * <repeat> ::= <paren> ("*" | "?" | "+")?
+ * <repeat> ::= <paren> ("*" | "?" | "+" | <bounds>)*
+ * <bounds> ::= "{" <count> ("," <count>?)? "}"
  * <paren> ::= <char> | "(" <or> ")"
- * <char> ::= (any alphanumeric char)
+ * <char> ::= (any alphanumeric char) | <class>
+ * <class> ::= "[" "^"? (<char> ("-" <char>)?)+ "]" | "."
  */
 class Parser {
  public:
@@ -48,23 +56,41 @@ class Parser {
     std::vector<ParseNode> nodes;
     std::string err_msg;
     index first_node;
+    // The byte sets of the class nodes.
+    std::vector<ByteSet> sets;
   };
 
+  // Expanded repetitions must stay below this many nodes.
+  static constexpr size_t max_nodes = 1 << 16;
+
   Parser() = delete;
-  explicit Parser(const std::string& regex) : scanner{regex} {}
+  constexpr explicit Parser(const std::string& regex) : scanner{regex} {}
 
-  ParseResult parse() {
+  constexpr ParseResult parse() {
+    if (!scanner.err_msg.empty()) {
+      return {.nodes = {},
+              .err_msg = scanner.err_msg,
+              .first_node = 0,
+              .sets = {}};
+    }
     if (scanner.paren_balance != 0) {
-      return {.nodes = {}, .err_msg = "unbalanced parens", .first_node = 0};
+      return {.nodes = {},
+              .err_msg = "unbalanced parens",
+              .first_node = 0,
+              .sets = {}};
     }
     if (scanner.node_charcount == 0) {
-      return {.nodes = {}, .err_msg = "empty regex", .first_node = 0};
+      return {.nodes = {},
+              .err_msg = "empty regex",
+              .first_node = 0,
+              .sets = {}};
     }
 
     ParseResult parse_result{
         .nodes = std::vector<ParseNode>(scanner.node_charcount),
         .err_msg = "",
         .first_node = 0,
+        .sets = scanner.sets,
     };
 
     // Launch parsing by calling the "outermost" grammar rule
@@ -73,7 +99,7 @@ class Parser {
   }
 
  private:
-  index get_or(ParseResult& result) {
+  constexpr index get_or(ParseResult& result) {
     const index left = get_concat(result);
     if (left == -1) [[unlikely]] {
       return -1;
@@ -93,7 +119,7 @@ class Parser {
                          result);
   }
 
-  index get_concat(ParseResult& result) {
+  constexpr index get_concat(ParseResult& result) {
     const index left = get_repeat(result);
     if (left == -1) [[unlikely]] {
       return -1;
@@ -113,31 +139,122 @@ class Parser {
                          result);
   }
 
-  index get_repeat(ParseResult& result) {
+  constexpr index get_repeat(ParseResult& result) {
+    using NodeType = ParseNode::NodeType;
+    // Nodes are numbered in post-order, so the subtree of `repeated` is
+    // exactly the nodes from `first` to `repeated`.
+    const index first = node_counter;
+    index repeated = get_paren(result);
+    while (repeated != -1 && !scanner.is_next_escaped()) {
+      if (const index bounds = scanner.next_repeat(); bounds != -1) {
+        scanner.pop();
+        repeated = get_bounded(
+            first, repeated, scanner.bounds[static_cast<size_t>(bounds)],
+            result);
+        continue;
+      }
+      const char symbol = scanner.peek();
+      if (symbol != '*' && symbol != '?' && symbol != '+') {
+        break;
+      }
+      scanner.pop();
+      NodeType type = NodeType::ONE_OR_MORE;
+      if (symbol == '*') {
+        type = NodeType::KLEENE_STAR;
+      }
+      if (symbol == '?') {
+        type = NodeType::OPTIONAL;
+      }
+      repeated = set_next_node(
+          {.left = repeated, .right = -1, .type = type, .character = '\0'},
+          result);
+    }
+    return repeated;
+  }
+
+  /**
+   * Expand "x{min,max}" for the subtree x made of the nodes from `first` to
+   * `root`, as min copies of x followed by "x*" if there is no max, or else
+   * by max - min nested optional copies "(x(x(x)?)?)?".
+   *
+   * The nesting keeps the edges of the Thompson NFA linear in the count:
+   * every optional copy is only reachable through the previous one, so no
+   * copy gets an edge to all the ones after it, as with "x?x?x?". When x
+   * itself is nullable, each copy still reaches all the later ones through
+   * epsilon edges or follow sets, quadratic in total. The automata bound
+   * that cost themselves, see NFA::closure_budget and
+   * PositionAutomaton::max_follow_bits. A "{min,}" with min > 0 reuses its
+   * last required copy as "x+".
+   */
+  constexpr index get_bounded(index first, index root,
+                              const Scanner::Bounds& bounds,
+                              ParseResult& result) {
     using NodeType = ParseNode::NodeType;
-    const index paren = get_paren(result);
-    if (paren == -1) [[unlikely]] {
+    const auto unary = [&](NodeType type, index inner) {
+      return set_next_node(
+          {.left = inner, .right = -1, .type = type, .character = '\0'},
+          result);
+    };
+    const auto concat = [&](index left, index right) {
+      return set_next_node({.left = left,
+                            .right = right,
+                            .type = NodeType::CONCAT,
+                            .character = '\0'},
+                           result);
+    };
+    // The first copy is x itself.
+    bool used = false;
+    const auto copy = [&]() {
+      if (!used) {
+        used = true;
+        return root;
+      }
+      return copy_subtree(first, root, result);
+    };
+
+    // Every copy of x takes its nodes plus at most two to join it.
+    const size_t copies = bounds.max == Scanner::Bounds::UNBOUNDED
+                              ? bounds.min + 1
+                              : bounds.max;
+    if (static_cast<size_t>(node_counter) +
+            copies * static_cast<size_t>(root - first + 3) >
+        max_nodes) [[unlikely]] {
+      result.err_msg = "repetitions make the regex too large";
       return -1;
     }
 
-    const char symbol = scanner.peek();
-    if (scanner.is_next_escaped() ||
-        (symbol != '*' && symbol != '?' && symbol != '+')) {
-      return paren;
+    size_t required = bounds.min;
+    index tail = -1;
+    if (bounds.max == Scanner::Bounds::UNBOUNDED) {
+      tail = unary(bounds.min == 0 ? NodeType::KLEENE_STAR
+                                   : NodeType::ONE_OR_MORE,
+                   copy());
+      required -= static_cast<size_t>(bounds.min != 0);
+    } else if (bounds.max > bounds.min) {
+      tail = unary(NodeType::OPTIONAL, copy());
+      for (size_t k = bounds.min + 1; k < bounds.max; ++k) {
+        tail = unary(NodeType::OPTIONAL, concat(copy(), tail));
+      }
     }
-    scanner.pop();
-    NodeType type = NodeType::ONE_OR_MORE;
-    if (symbol == '*') {
-      type = NodeType::KLEENE_STAR;
+    for (size_t k = 0; k < required; ++k) {
+      tail = tail == -1 ? copy() : concat(copy(), tail);
     }
-    if (symbol == '?') {
-      type = NodeType::OPTIONAL;
+    return tail;
+  }
+
+  // Append a copy of the subtree made of the nodes from `first` to `root`.
+  constexpr index copy_subtree(index first, index root, ParseResult& result) {
+    const index offset = node_counter - first;
+    for (index i = first; i <= root; ++i) {
+      ParseNode node = result.nodes[static_cast<size_t>(i)];
+      node.left = node.left == -1 ? -1 : node.left + offset;
+      node.right = node.right == -1 ? -1 : node.right + offset;
+      set_next_node(std::move(node), result);
     }
-    return set_next_node(
-        {.left = paren, .right = -1, .type = type, .character = '\0'}, result);
+    return root + offset;
   }
 
-  index get_paren(ParseResult& result) {
+  constexpr index get_paren(ParseResult& result) {
     if (scanner.is_next_escaped() || scanner.peek() != '(') {
       return get_char(result);
     }
@@ -153,14 +270,27 @@ class Parser {
     }
     if (const char c = scanner.pop(); scanner.is_next_escaped() || c != ')')
         [[unlikely]] {
-      result.err_msg = "')' expected, got char with code" +
-                       std::to_string(static_cast<int>(c));
+      result.err_msg =
+          "')' expected, got char with code" + to_decimal(static_cast<int>(c));
       return -1;
     }
     return or_expr;
   }
 
-  index get_char(ParseResult& result) {
+  constexpr index get_char(ParseResult& result) {
+    if (scanner.next_repeat() != -1) [[unlikely]] {
+      result.err_msg = "nothing to repeat";
+      return -1;
+    }
+    if (const index set = scanner.next_class(); set != -1) {
+      scanner.pop();
+      return set_next_node({.left = -1,
+                            .right = -1,
+                            .type = ParseNode::NodeType::CLASS,
+                            .character = '\0',
+                            .set = set},
+                           result);
+    }
     return set_next_node(
         {
             .left = -1,
@@ -171,11 +301,29 @@ class Parser {
         result);
   }
 
-  index set_next_node(ParseNode&& node, ParseResult& result) {
-    result.nodes[static_cast<size_t>(node_counter)] = node;
+  // Repetitions add nodes past the ones the scanner counted.
+  constexpr index set_next_node(ParseNode&& node, ParseResult& result) {
+    if (static_cast<size_t>(node_counter) == result.nodes.size()) {
+      result.nodes.push_back(node);
+    } else {
+      result.nodes[static_cast<size_t>(node_counter)] = node;
+    }
     return node_counter++;
   }
 
+  // std::to_string is not constexpr.
+  static constexpr std::string to_decimal(int value) {
+    std::string digits;
+    const bool negative = value < 0;
+    unsigned magnitude = negative ? 0U - static_cast<unsigned>(value)
+                                  : static_cast<unsigned>(value);
+    do {
+      digits.insert(digits.begin(), static_cast<char>('0' + magnitude % 10));
+      magnitude /= 10;
+    } while (magnitude != 0);
+    return negative ? "-" + digits : digits;
+  }
+
   Scanner scanner;
   index node_counter = 0;
 };
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "parser.hpp"
+
+namespace RM::Impl {
+
+/** What every match of a regex has to start with.
+ * `literal` is a string all matches start with, possibly empty.
+ * `first_bytes` flags the bytes a non-empty match can start with.
+ * If the regex matches the empty string, any position can start a match.
+ */
+struct Prefix {
+  static constexpr size_t alphabet_size = 256;
+
+  std::string literal;
+  std::array<bool, alphabet_size> first_bytes{};
+  size_t first_byte_count = 0;
+  bool nullable = false;
+  bool valid = true;
+
+  // Whether a search can skip ahead at all.
+  bool is_selective() const {
+    return valid && !nullable && first_byte_count < alphabet_size;
+  }
+};
+
+/**
+ * Extract the required literal prefix and the possible first bytes of the
+ * regex from its parse tree.
+ */
+inline Prefix create_prefix(const Parser::ParseResult& parsed) {
+  using NodeType = ParseNode::NodeType;
+  Prefix result;
+  if (!parsed.err_msg.empty()) [[unlikely]] {
+    result.valid = false;
+    return result;
+  }
+  const std::vector<ParseNode>& nodes = parsed.nodes;
+
+  // `exact` is set when the subtree matches nothing but `literal`.
+  struct literal_info {
+    std::string literal;
+    bool exact;
+  };
+  const auto literal_of = [&](ParseNode::index i, auto& f) -> literal_info {
+    const auto [left, right, type, character, set] =
+        nodes[static_cast<size_t>(i)];
+    switch (type) {
+      case NodeType::CHAR:
+        return {std::string(1, character), true};
+      case NodeType::CONCAT: {
+        literal_info l = f(left, f);
+        if (!l.exact) {
+          return l;
+        }
+        const literal_info r = f(right, f);
+        return {l.literal + r.literal, r.exact};
+      }
+      case NodeType::OR: {
+        const literal_info l = f(left, f);
+        const literal_info r = f(right, f);
+        size_t common = 0;
+        while (common < l.literal.size() && common < r.literal.size() &&
+               l.literal[common] == r.literal[common]) {
+          ++common;
+        }
+        return {l.literal.substr(0, common),
+                l.exact && r.exact && l.literal == r.literal};
+      }
+      case NodeType::ONE_OR_MORE:
+        return {f(left, f).literal, false};
+      default:
+        return {"", false};
+    }
+  };
+
+  // Returns whether the subtree is nullable and flags its first bytes.
+  const auto first_of = [&](ParseNode::index i, auto& f) -> bool {
+    const auto [left, right, type, character, set] =
+        nodes[static_cast<size_t>(i)];
+    switch (type) {
+      case NodeType::CHAR:
+        result.first_bytes[static_cast<unsigned char>(character)] = true;
+        return false;
+      case NodeType::CLASS:
+        parsed.sets[static_cast<size_t>(set)].for_each_range(
+            [&](char first, char last) {
+              for (size_t b = static_cast<unsigned char>(first);
+                   b <= static_cast<unsigned char>(last); ++b) {
+                result.first_bytes[b] = true;
+              }
+            });
+        return false;
+      case NodeType::CONCAT:
+        return f(left, f) && f(right, f);
+      case NodeType::OR: {
+        const bool l = f(left, f);
+        const bool r = f(right, f);
+        return l || r;
+      }
+      case NodeType::ONE_OR_MORE:
+        return f(left, f);
+      case NodeType::KLEENE_STAR:
+      case NodeType::OPTIONAL:
+        f(left, f);
+        return true;
+      default:
+        result.valid = false;
+        return true;
+    }
+  };
+
+  result.literal = literal_of(parsed.first_node, literal_of).literal;
+  result.nullable = first_of(parsed.first_node, first_of);
+  for (const bool flag : result.first_bytes) {
+    result.first_byte_count += static_cast<size_t>(flag);
+  }
+  return result;
+}
+
+/**
+ * Find the first position at or after `from` where a match could start.
+ *
+ * A required literal is looked up with `std::string_view::find` and a single
+ * first byte with `memchr`, both of which the standard library implements
+ * with vectorized byte search. Other sets of first bytes are scanned with a
+ * lookup table. Returns `std::string_view::npos` if no position can match.
+ */
+inline size_t find_candidate(const Prefix& prefix, std::string_view s,
+                             size_t from) {
+  if (from > s.size()) {
+    return std::string_view::npos;
+  }
+  if (!prefix.is_selective()) {
+    return from;
+  }
+  if (from == s.size()) {
+    return std::string_view::npos;
+  }
+  if (prefix.literal.size() > 1) {
+    return s.find(prefix.literal, from);
+  }
+  if (prefix.first_byte_count == 1) {
+    const char* begin = s.data() + from;
+    size_t byte = 0;
+    while (!prefix.first_bytes[byte]) {
+      ++byte;
+    }
+    const void* found = std::memchr(begin, static_cast<int>(byte),
+                                    s.size() - from);
+    return found == nullptr
+               ? std::string_view::npos
+               : from + static_cast<size_t>(static_cast<const char*>(found) -
+                                            begin);
+  }
+  for (size_t i = from; i < s.size(); ++i) {
+    if (prefix.first_bytes[static_cast<unsigned char>(s[i])]) {
+      return i;
+    }
+  }
+  return std::string_view::npos;
+}
+
+}  // namespace RM::Impl
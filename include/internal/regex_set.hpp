@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "nfa.hpp"
+#include "nfa_creation.hpp"
+#include "parser.hpp"
+#include "state_bitset.hpp"
+
+namespace RM::Impl {
+
+/** The NFAs of many regexes joined under one start state.
+ *
+ * State 0 has an epsilon edge to the Thompson NFA of every regex, which are
+ * laid out one after another, and `owner` maps the final state of each regex
+ * back to its index. One simulation over the input tells every regex that
+ * matched.
+ *
+ * The cost of a scan should follow the regexes that are still alive, not
+ * how many there are. So the active states are kept as a list, and the first
+ * step out of the start state, which would touch every regex, is precomputed
+ * for every byte.
+ */
+struct SetNFA {
+  static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+  static constexpr size_t alphabet_size = 256;
+
+  explicit SetNFA(NFA&& automaton) : nfa{std::move(automaton)} {}
+
+  std::vector<size_t> matches(std::string_view s) const {
+    if (nfa.error != NFA::err_state::OK) [[unlikely]] {
+      return {};
+    }
+    if (s.empty()) {
+      return empty_matches;
+    }
+    const auto& first = first_steps[static_cast<unsigned char>(s[0])];
+    std::vector<NFA::state> current(first.begin(), first.end());
+    std::vector<NFA::state> next;
+    current.reserve(nfa.size);
+    next.reserve(nfa.size);
+    StateBitset seen{nfa.size};
+    std::vector<NFA::state> stack;
+
+    for (size_t i = 1; i < s.size() && !current.empty(); ++i) {
+      for (const NFA::state from : current) {
+        for (const NFA::edge& e : nfa.transitions[from]) {
+          if (!e.reads(s[i])) {
+            continue;
+          }
+          nfa.for_each_in_closure(e.to, stack, [&](NFA::state to) {
+            if (seen.contains(to)) {
+              return false;
+            }
+            seen.insert(to);
+            next.push_back(to);
+            return true;
+          });
+        }
+      }
+      for (const NFA::state to : next) {
+        seen.erase(to);
+      }
+      std::swap(current, next);
+      next.clear();
+    }
+
+    std::vector<size_t> result;
+    for (const NFA::state st : current) {
+      if (owner[st] != NONE) {
+        result.push_back(owner[st]);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  NFA nfa;
+  std::vector<NFA::state> finals;
+  std::vector<size_t> owner;
+  std::array<std::vector<NFA::state>, alphabet_size> first_steps;
+  std::vector<size_t> empty_matches;
+};
+
+/**
+ * Join the Thompson NFAs of several parse trees under one start state.
+ * Every tree must be valid.
+ */
+inline SetNFA create_set(const std::vector<Parser::ParseResult>& parsed) {
+  std::vector<std::vector<size_t>> sizes;
+  sizes.reserve(parsed.size());
+  size_t total = 1;
+  for (const Parser::ParseResult& p : parsed) {
+    sizes.push_back(thompson_sizes(p));
+    if (sizes.back().empty()) [[unlikely]] {
+      return SetNFA{create_err(NFA::err_state::BAD_PARSE)};
+    }
+    total += sizes.back()[static_cast<size_t>(p.first_node)];
+  }
+
+  SetNFA result{NFA{total, {0, 0}}};
+  result.finals.reserve(parsed.size());
+  result.owner.assign(total, SetNFA::NONE);
+  NFA::state first = 1;
+  for (size_t k = 0; k < parsed.size(); ++k) {
+    emit_thompson(result.nfa, parsed[k], sizes[k], first);
+    result.nfa.add_transition({0, first}, EPS);
+    first += sizes[k][static_cast<size_t>(parsed[k].first_node)];
+    result.finals.push_back(first - 1);
+    result.owner[first - 1] = k;
+  }
+  NFA& nfa = result.nfa;
+  nfa.compute_closures();
+
+  // `seen` only ever holds whole closures, so the closure of a state it
+  // has adds nothing new.
+  StateBitset seen{nfa.size};
+  std::vector<NFA::state> stack;
+  const auto add_closure = [&](NFA::state s, std::vector<NFA::state>& out) {
+    nfa.for_each_in_closure(s, stack, [&](NFA::state to) {
+      if (seen.contains(to)) {
+        return false;
+      }
+      seen.insert(to);
+      out.push_back(to);
+      return true;
+    });
+  };
+  const auto clear = [&](const std::vector<NFA::state>& states) {
+    for (const NFA::state to : states) {
+      seen.erase(to);
+    }
+  };
+
+  std::vector<NFA::state> initial;
+  add_closure(nfa.initial_state, initial);
+  clear(initial);
+  for (const NFA::state s : initial) {
+    if (result.owner[s] != SetNFA::NONE) {
+      result.empty_matches.push_back(result.owner[s]);
+    }
+  }
+  for (size_t b = 0; b < SetNFA::alphabet_size; ++b) {
+    auto& targets = result.first_steps[b];
+    for (const NFA::state s : initial) {
+      for (const NFA::edge& e : nfa.transitions[s]) {
+        if (e.reads(static_cast<char>(b))) {
+          add_closure(e.to, targets);
+        }
+      }
+    }
+    clear(targets);
+    std::sort(targets.begin(), targets.end());
+  }
+  std::sort(result.empty_matches.begin(), result.empty_matches.end());
+  return result;
+}
+
+}  // namespace RM::Impl
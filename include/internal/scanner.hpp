@@ -1,18 +1,38 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <limits>
 #include <string>
-#include <unordered_set>
+#include <vector>
+
+#include "byte_set.hpp"
 
 namespace RM::Impl {
 
 /** Reader and preprocessor of regex input.
  * Adds concatenation: "abc" -> "a.b.c".
+ * Reads character classes like "[a-z]", "[^0-9]" and the wildcard "." into
+ * byte sets, each left in `regex` as a single "[" placeholder, and counted
+ * repetitions like "{2,5}" into bounds, left as a "{" placeholder.
  * Checks for problems such as no meaningful content: "(()())"
  * or unbalanced parentheses: "((ab)".
+ * Everything is constexpr, so that patterns can be scanned at compile time.
  */
 class Scanner {
  public:
-  explicit Scanner(const std::string& input) {
+  // The bounds of "{min,max}". "{min}" has max == min, "{min,}" has no max.
+  struct Bounds {
+    static constexpr size_t UNBOUNDED = std::numeric_limits<size_t>::max();
+    size_t min;
+    size_t max;
+    bool operator==(const Bounds&) const = default;
+  };
+  // Larger counts are rejected, as every repetition is a copy of its
+  // subtree.
+  static constexpr size_t max_count = 1000;
+
+  constexpr explicit Scanner(const std::string& input) {
     if (input.empty()) {
       return;
     }
@@ -25,12 +45,42 @@ class Scanner {
         --node_charcount;
         const char next = input[i + 1];
         regex.push_back(next);
-        escapes.emplace(regex.size() - 1);
+        escapes.push_back(regex.size() - 1);
         if (i + 2 < n && is_right_concat(input[i + 2])) {
           regex.push_back('.');
           ++node_charcount;
         }
         ++i;
+      } else if (c == '[' || c == '.') {
+        size_t end = i;
+        sets.push_back(c == '.' ? ByteSet::wildcard() : scan_class(input, end));
+        if (!err_msg.empty()) [[unlikely]] {
+          return;
+        }
+        node_charcount -= end - i;
+        regex.push_back('[');
+        classes.push_back(regex.size() - 1);
+        if (end + 1 < n && is_right_concat(input[end + 1])) {
+          regex.push_back('.');
+          ++node_charcount;
+        }
+        i = end;
+      } else if (c == '{') {
+        size_t end = i;
+        bounds.push_back(scan_bounds(input, end));
+        if (!err_msg.empty()) [[unlikely]] {
+          return;
+        }
+        // The parser copies the repeated subtree instead, so the
+        // placeholder is no node of its own.
+        node_charcount -= end - i + 1;
+        regex.push_back('{');
+        repeats.push_back(regex.size() - 1);
+        if (end + 1 < n && is_right_concat(input[end + 1])) {
+          regex.push_back('.');
+          ++node_charcount;
+        }
+        i = end;
       } else {
         const auto [balance, is_paren] = char_check(c);
         paren_balance -= balance;
@@ -44,14 +94,32 @@ class Scanner {
     }
   }
 
-  char peek() const { return index >= regex.size() ? '\0' : regex[index]; }
-  char pop() { return index >= regex.size() ? '\0' : regex[index++]; }
-  bool is_next_escaped() const { return escapes.contains(index); }
+  constexpr char peek() const {
+    return index >= regex.size() ? '\0' : regex[index];
+  }
+  constexpr char pop() { return index >= regex.size() ? '\0' : regex[index++]; }
+  constexpr bool is_next_escaped() const {
+    return std::binary_search(escapes.begin(), escapes.end(), index);
+  }
+  // The index in `sets` of the next character's class, -1 if it is none.
+  constexpr int next_class() const { return position_of(classes); }
+  // The index in `bounds` of the next repetition, -1 if it is none.
+  constexpr int next_repeat() const { return position_of(repeats); }
 
   size_t node_charcount = 0;
   int paren_balance = 0;
   std::string regex;
-  std::unordered_set<size_t> escapes;
+  // Indices of the escaped characters in `regex`, in increasing order.
+  std::vector<size_t> escapes;
+  // Indices of the class placeholders in `regex`, in increasing order, and
+  // their byte sets.
+  std::vector<size_t> classes;
+  std::vector<ByteSet> sets;
+  // Indices of the repetition placeholders in `regex`, in increasing order,
+  // and their bounds.
+  std::vector<size_t> repeats;
+  std::vector<Bounds> bounds;
+  std::string err_msg;
   size_t index = 0;
 
  private:
@@ -71,12 +139,110 @@ class Scanner {
     ;
   }
 
+  /**
+   * Read the class that starts with the "[" at `end` and leave `end` at its
+   * closing "]". A leading "^" negates the class, "x-y" is a range, and
+   * "\" escapes the next character. "]" as the first member and "-" as the
+   * first or last one stand for themselves.
+   */
+  constexpr ByteSet scan_class(const std::string& input, size_t& end) {
+    const size_t n = input.size();
+    size_t i = end + 1;
+    const bool negated = i < n && input[i] == '^';
+    i += static_cast<size_t>(negated);
+    ByteSet result;
+    const auto member = [&]() {
+      if (input[i] == '\\' && i + 1 < n) {
+        ++i;
+      }
+      return input[i++];
+    };
+    for (bool first = true; i < n && (first || input[i] != ']');
+         first = false) {
+      const char lo = member();
+      if (i + 1 < n && input[i] == '-' && input[i + 1] != ']') {
+        ++i;
+        const char hi = member();
+        if (static_cast<unsigned char>(hi) < static_cast<unsigned char>(lo))
+            [[unlikely]] {
+          err_msg = "bad character range";
+          return result;
+        }
+        result.insert_range(lo, hi);
+      } else {
+        result.insert(lo);
+      }
+    }
+    if (i >= n) [[unlikely]] {
+      err_msg = "unterminated character class";
+      return result;
+    }
+    end = i;
+    return negated ? result.complement() : result;
+  }
+
+  /**
+   * Read the repetition that starts with the "{" at `end` and leave `end` at
+   * its closing "}": "{m}", "{m,}" or "{m,n}" with m <= n <= `max_count`
+   * and n > 0.
+   */
+  constexpr Bounds scan_bounds(const std::string& input, size_t& end) {
+    const size_t n = input.size();
+    size_t i = end + 1;
+    bool has_digits = true;
+    bool too_large = false;
+    const auto number = [&]() {
+      const size_t start = i;
+      size_t value = 0;
+      while (i < n && input[i] >= '0' && input[i] <= '9') {
+        too_large = too_large || value > max_count;
+        value = value * 10 + static_cast<size_t>(input[i] - '0');
+        ++i;
+      }
+      has_digits = has_digits && i != start;
+      too_large = too_large || value > max_count;
+      return value;
+    };
+    Bounds result{.min = number(), .max = 0};
+    result.max = result.min;
+    if (i < n && input[i] == ',') {
+      ++i;
+      result.max = i < n && input[i] == '}' ? Bounds::UNBOUNDED : number();
+    }
+    if (!has_digits || i >= n || input[i] != '}') [[unlikely]] {
+      err_msg = "bad repetition";
+      return result;
+    }
+    if (too_large) [[unlikely]] {
+      err_msg = "repetition count too large";
+      return result;
+    }
+    if (result.max < result.min || result.max == 0) [[unlikely]] {
+      err_msg = "bad repetition bounds";
+      return result;
+    }
+    end = i;
+    return result;
+  }
+
+  constexpr int position_of(const std::vector<size_t>& positions) const {
+    const auto it = std::lower_bound(positions.begin(), positions.end(), index);
+    return it == positions.end() || *it != index
+               ? -1
+               : static_cast<int>(it - positions.begin());
+  }
+
   static constexpr bool is_left_concat(char c) {
-    return static_cast<bool>(std::isalnum(c)) || c == ')' || c == '*' ||
-           c == '?' || c == '+';
+    return is_alnum(c) || c == ')' || c == '*' || c == '?' || c == '+';
+  }
+  // std::isalnum is not constexpr, this is the same test in the C locale.
+  static constexpr bool is_alnum(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z');
   }
   static constexpr bool is_right_concat(char c) {
-    return c != ')' && c != '|' && c != '*' && c != '?' && c != '+';
+    return c != ')' && c != '|' && c != '*' && c != '?' && c != '+' &&
+           c != '{';
   }
 };
 
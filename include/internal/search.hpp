@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "nfa.hpp"
+#include "prefix.hpp"
+
+namespace RM::Impl {
+
+// A match of a regex in a string, as the half-open range [begin, end).
+struct Span {
+  size_t begin;
+  size_t end;
+  bool operator==(const Span&) const = default;
+};
+
+/** Unanchored, leftmost-longest search with an NFA.
+ *
+ * The search is one pass over the input, which reports the non-overlapping
+ * matches in order. A new thread is started at every position, and every
+ * active state remembers the leftmost position a thread reaching it started
+ * at. A thread reaching the final state records a pending match: it extends
+ * the pending match it started, replaces those starting after it, or follows
+ * the last one. Threads that started inside a pending match are dropped. The
+ * first pending match is reported once no thread that started at or before
+ * it is active, and the threads after it run on towards the next match, so
+ * no byte is read twice. When no thread is active, the search jumps to the
+ * next position the `Prefix` allows.
+ *
+ * The scratch space is allocated once and reused by every search. Pending
+ * matches are queued while an earlier thread may still replace them, which
+ * may hold one match per byte until that thread ends.
+ */
+class Searcher {
+ public:
+  static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+  Searcher(const NFA& automaton, const Prefix& match_prefix)
+      : nfa{&automaton},
+        prefix{&match_prefix},
+        starts(automaton.size, NONE),
+        next_starts(automaton.size, NONE) {
+    active.reserve(automaton.size);
+    next_active.reserve(automaton.size);
+    if (nfa->error == NFA::err_state::OK) {
+      nfa->for_each_in_closure(
+          nfa->initial_state, stack,
+          [&](NFA::state to) { return propose(starts, active, to, 0); });
+      nullable = starts[nfa->final_state] != NONE;
+      clear(starts, active);
+    }
+  }
+
+  /** The leftmost-longest match in `s` starting at `from` or later. */
+  std::optional<Span> find(std::string_view s, size_t from) {
+    start(s, from);
+    return next();
+  }
+
+  /** Search `s` from `from`, for `next` to report the matches. */
+  void start(std::string_view s, size_t from) {
+    clear(starts, active);
+    pending.clear();
+    input = s;
+    pos = from;
+    done = nfa->error != NFA::err_state::OK || from > s.size();
+  }
+
+  /** The next match, which starts where the previous one ended or later,
+   * and one byte later after an empty match.
+   */
+  std::optional<Span> next() {
+    while (true) {
+      if (!pending.empty() && (done || pending.front().begin < min_start())) {
+        const Span found = pending.front();
+        pending.pop_front();
+        return found;
+      }
+      if (done) {
+        return std::nullopt;
+      }
+      advance();
+    }
+  }
+
+ private:
+  // Start a thread at `pos`, then read the byte there.
+  void advance() {
+    if (active.empty()) {
+      pos = find_candidate(*prefix, input, pos);
+      if (pos == std::string_view::npos) {
+        done = true;
+        return;
+      }
+    }
+    nfa->for_each_in_closure(
+        nfa->initial_state, stack,
+        [&](NFA::state to) { return propose(starts, active, to, pos); });
+    if (nullable) {
+      record(pos);
+    }
+    if (pos == input.size()) {
+      clear(starts, active);
+      done = true;
+      return;
+    }
+    step(input[pos]);
+    ++pos;
+    if (const size_t begin = starts[nfa->final_state]; begin != NONE) {
+      record(begin);
+    }
+  }
+
+  // Record a match from `begin` to `pos`, and drop the threads it overlaps.
+  void record(size_t begin) {
+    auto it = std::ranges::lower_bound(pending, begin, {}, &Span::begin);
+    if (it != pending.end() && it->begin == begin) {
+      it->end = pos;
+    } else {
+      it = pending.insert(it, Span{.begin = begin, .end = pos});
+    }
+    pending.erase(it + 1, pending.end());
+    if (begin + 1 < pos) {
+      std::erase_if(active, [&](NFA::state s) {
+        if (starts[s] > begin && starts[s] < pos) {
+          starts[s] = NONE;
+          return true;
+        }
+        return false;
+      });
+    }
+  }
+
+  // The leftmost start of an active thread, or NONE.
+  size_t min_start() const {
+    size_t result = NONE;
+    for (const NFA::state s : active) {
+      result = std::min(result, starts[s]);
+    }
+    return result;
+  }
+
+  // Record that a thread started at `start` reaches `s`, keeping the
+  // leftmost start. Whether that changed the start of `s`.
+  static bool propose(std::vector<size_t>& state_starts,
+                      std::vector<NFA::state>& states, NFA::state s,
+                      size_t start) {
+    if (state_starts[s] == NONE) {
+      states.push_back(s);
+      state_starts[s] = start;
+      return true;
+    }
+    if (start < state_starts[s]) {
+      state_starts[s] = start;
+      return true;
+    }
+    return false;
+  }
+
+  static void clear(std::vector<size_t>& state_starts,
+                    std::vector<NFA::state>& states) {
+    for (const NFA::state s : states) {
+      state_starts[s] = NONE;
+    }
+    states.clear();
+  }
+
+  // Advance every thread by `c`.
+  void step(char c) {
+    for (const NFA::state s : active) {
+      const size_t start = starts[s];
+      for (const NFA::edge& e : nfa->transitions[s]) {
+        if (!e.reads(c)) {
+          continue;
+        }
+        nfa->for_each_in_closure(e.to, stack, [&](NFA::state to) {
+          return propose(next_starts, next_active, to, start);
+        });
+      }
+    }
+    clear(starts, active);
+    std::swap(starts, next_starts);
+    std::swap(active, next_active);
+  }
+
+  const NFA* nfa;
+  const Prefix* prefix;
+  bool nullable = false;
+  std::vector<size_t> starts;
+  std::vector<size_t> next_starts;
+  std::vector<NFA::state> active;
+  std::vector<NFA::state> next_active;
+  std::vector<NFA::state> stack;
+  std::deque<Span> pending;
+  std::string_view input;
+  size_t pos = 0;
+  bool done = true;
+};
+
+/** The non-overlapping leftmost-longest matches in a string, in order.
+ * After an empty match the next search starts one byte later.
+ */
+class Matches {
+ public:
+  class iterator {
+   public:
+    using value_type = Span;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator(Matches* owner) : matches{owner} { advance(); }
+
+    const Span& operator*() const { return current; }
+    const Span* operator->() const { return &current; }
+    iterator& operator++() {
+      advance();
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+    bool operator==(std::default_sentinel_t /*unused*/) const {
+      return matches == nullptr;
+    }
+
+   private:
+    void advance() {
+      const std::optional<Span> found = matches->searcher.next();
+      if (found) {
+        current = *found;
+      } else {
+        matches = nullptr;
+      }
+    }
+
+    Matches* matches = nullptr;
+    Span current{};
+  };
+
+  Matches(const NFA& nfa, const Prefix& prefix, std::string_view s)
+      : searcher{nfa, prefix}, input{s} {}
+
+  iterator begin() {
+    searcher.start(input, 0);
+    return iterator{this};
+  }
+  std::default_sentinel_t end() const { return {}; }
+
+ private:
+  Searcher searcher;
+  std::string_view input;
+};
+
+}  // namespace RM::Impl
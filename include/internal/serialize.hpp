@@ -0,0 +1,437 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "byte_classes.hpp"
+#include "dfa.hpp"
+#include "nfa.hpp"
+#include "state_bitset.hpp"
+
+namespace RM::Impl {
+
+/** The binary formats of compiled automata.
+ *
+ * Every integer is a little-endian uint32 and every label or flag one byte,
+ * whatever the host. A blob starts with a 16-byte header: a 4-byte magic,
+ * the format version, the state count and a reserved zero word. The arrays
+ * that follow are read in place by the views below, so a blob can be used
+ * straight from an mmap'd file without copying or parsing it. Reads go
+ * through memcpy, so the blob needs no particular alignment.
+ *
+ * NFA ("RMNF"), after the header:
+ *   initial state, final state, edge count E, closure length C,
+ *   edge offsets [size + 1], edge targets [E], edge labels [E] (a first
+ *   and a last byte each, padded to 4), closure offsets [size + 1],
+ *   closures [C].
+ * The edges of state s are [edge_offsets[s], edge_offsets[s + 1]), and its
+ * epsilon-closure is laid out the same way. Epsilon edges are not stored,
+ * the closures replace them.
+ *
+ * DFA ("RMDF"), after the header:
+ *   initial state, dead state, class count K, byte classes [256] (bytes),
+ *   table [size * K], accepting [size] (bytes, padded to 4).
+ * Row s of the table holds the next state for each byte class.
+ *
+ * Version 2 added the byte classes of the DFA and version 3 the byte ranges
+ * of NFA edges; older blobs are rejected.
+ */
+namespace SerialImpl {
+
+constexpr std::uint32_t version = 3;
+constexpr size_t header_size = 16;
+constexpr std::array<char, 4> nfa_magic{'R', 'M', 'N', 'F'};
+constexpr std::array<char, 4> dfa_magic{'R', 'M', 'D', 'F'};
+
+inline void put_u32(std::vector<char>& out, size_t value) {
+  for (size_t i = 0; i < 4; ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFFU));
+  }
+}
+
+inline std::uint32_t get_u32(const char* p) {
+  std::uint32_t value = 0;
+  std::memcpy(&value, p, sizeof(value));
+  if constexpr (std::endian::native == std::endian::big) {
+    value = ((value & 0xFFU) << 24U) | ((value & 0xFF00U) << 8U) |
+            ((value >> 8U) & 0xFF00U) | (value >> 24U);
+  }
+  return value;
+}
+
+inline void put_header(std::vector<char>& out,
+                       const std::array<char, 4>& magic, size_t size) {
+  out.insert(out.end(), magic.begin(), magic.end());
+  put_u32(out, version);
+  put_u32(out, size);
+  put_u32(out, 0);
+}
+
+// Reads the u32 array of `count` words at `offset`, advancing `offset`.
+// Returns nullptr if it does not fit into `bytes`.
+inline const char* take(std::span<const char> bytes, size_t& offset,
+                        size_t count, size_t width = 4) {
+  const size_t length = (count * width + 3) / 4 * 4;
+  if (count > bytes.size() || offset > bytes.size() ||
+      length > bytes.size() - offset) {
+    return nullptr;
+  }
+  const char* result = bytes.data() + offset;
+  offset += length;
+  return result;
+}
+
+}  // namespace SerialImpl
+
+/**
+ * Serialize an NFA with precomputed closures. Returns an empty blob if the
+ * NFA is invalid, has no closures or has 2^32 states or more.
+ */
+inline std::vector<char> save(const NFA& nfa) {
+  using SerialImpl::put_u32;
+  if (nfa.error != NFA::err_state::OK || !nfa.has_closures() ||
+      nfa.size >= std::numeric_limits<std::uint32_t>::max() ||
+      nfa.closures.size() >= std::numeric_limits<std::uint32_t>::max()) {
+    return {};
+  }
+  size_t edge_count = 0;
+  for (const auto& edges : nfa.transitions) {
+    edge_count += edges.size();
+  }
+  std::vector<char> out;
+  out.reserve(SerialImpl::header_size + 16 + 8 * (nfa.size + 1) +
+              6 * edge_count + 4 * nfa.closures.size() + 4);
+  SerialImpl::put_header(out, SerialImpl::nfa_magic, nfa.size);
+  put_u32(out, nfa.initial_state);
+  put_u32(out, nfa.final_state);
+  put_u32(out, edge_count);
+  put_u32(out, nfa.closures.size());
+
+  size_t offset = 0;
+  for (const auto& edges : nfa.transitions) {
+    put_u32(out, offset);
+    offset += edges.size();
+  }
+  put_u32(out, offset);
+  for (const auto& edges : nfa.transitions) {
+    for (const NFA::edge& e : edges) {
+      put_u32(out, e.to);
+    }
+  }
+  for (const auto& edges : nfa.transitions) {
+    for (const NFA::edge& e : edges) {
+      out.push_back(e.input);
+      out.push_back(e.last);
+    }
+  }
+  out.resize((out.size() + 3) / 4 * 4, '\0');
+  for (const size_t o : nfa.closure_offsets) {
+    put_u32(out, o);
+  }
+  for (const NFA::state s : nfa.closures) {
+    put_u32(out, s);
+  }
+  return out;
+}
+
+/** Serialize a DFA. Returns an empty blob if the DFA has an error. */
+inline std::vector<char> save(const DFA& dfa) {
+  using SerialImpl::put_u32;
+  if (dfa.error != DFA::err_state::OK) {
+    return {};
+  }
+  std::vector<char> out;
+  out.reserve(SerialImpl::header_size + 12 + ByteClasses::alphabet_size +
+              4 * dfa.table.size() + dfa.size + 4);
+  SerialImpl::put_header(out, SerialImpl::dfa_magic, dfa.size);
+  put_u32(out, dfa.initial_state);
+  put_u32(out, dfa.dead_state);
+  put_u32(out, dfa.classes.size());
+  for (const ByteClasses::id c : dfa.classes.map) {
+    out.push_back(static_cast<char>(c));
+  }
+  for (const DFA::state to : dfa.table) {
+    put_u32(out, to);
+  }
+  out.insert(out.end(), dfa.accepting.begin(), dfa.accepting.end());
+  out.resize((out.size() + 3) / 4 * 4, '\0');
+  return out;
+}
+
+/** Errors found when loading a blob. Loading checks every stored state, so
+ * that matching with a view never reads outside of the blob.
+ */
+enum class load_error : char {
+  OK = 0,
+  TRUNCATED,
+  BAD_MAGIC,
+  BAD_VERSION,
+  BAD_STATE,
+  BAD_CLASS,
+};
+
+/** An NFA read in place from a blob made by `save`.
+ * The blob must outlive the view. Matching simulates the NFA over two
+ * bitsets of `size` bits, stepping through the stored closures. They are
+ * allocated by every call, unless the caller passes a `Scratch` to reuse.
+ */
+class NFAView {
+ public:
+  using state = std::uint32_t;
+
+  // The bitsets of `match`, sized on first use.
+  struct Scratch {
+    size_t size = 0;
+    StateBitset current;
+    StateBitset next;
+  };
+
+  bool match(std::string_view s) const {
+    Scratch scratch;
+    return match(s, scratch);
+  }
+
+  bool match(std::string_view s, Scratch& scratch) const {
+    if (error != load_error::OK) {
+      return false;
+    }
+    if (scratch.size != size) {
+      scratch = {.size = size, .current = StateBitset{size},
+                 .next = StateBitset{size}};
+    }
+    StateBitset& current = scratch.current;
+    StateBitset& next = scratch.next;
+    current.clear();
+    add_closure(current, initial_state);
+    for (const char c : s) {
+      next.clear();
+      current.for_each([&](size_t from) {
+        const state end = word(edge_offsets, from + 1);
+        for (state i = word(edge_offsets, from); i < end; ++i) {
+          if (reads(i, c)) {
+            add_closure(next, word(edge_targets, i));
+          }
+        }
+      });
+      if (next.empty()) {
+        return false;
+      }
+      std::swap(current, next);
+    }
+    return current.contains(final_state);
+  }
+
+  size_t size = 0;
+  state initial_state = 0;
+  state final_state = 0;
+  load_error error = load_error::OK;
+
+ private:
+  friend NFAView load_nfa(std::span<const char> bytes);
+
+  static state word(const char* array, size_t i) {
+    return SerialImpl::get_u32(array + 4 * i);
+  }
+
+  bool reads(state i, char c) const {
+    const auto byte = static_cast<unsigned char>(c);
+    return static_cast<unsigned char>(edge_labels[2 * i]) <= byte &&
+           byte <= static_cast<unsigned char>(edge_labels[2 * i + 1]);
+  }
+
+  void add_closure(StateBitset& states, state s) const {
+    if (states.contains(s)) {
+      return;
+    }
+    const state end = word(closure_offsets, s + 1);
+    for (state i = word(closure_offsets, s); i < end; ++i) {
+      states.insert(word(closures, i));
+    }
+  }
+
+  const char* edge_offsets = nullptr;
+  const char* edge_targets = nullptr;
+  const char* edge_labels = nullptr;
+  const char* closure_offsets = nullptr;
+  const char* closures = nullptr;
+};
+
+/** A DFA read in place from a blob made by `save`.
+ * The blob must outlive the view.
+ */
+class DFAView {
+ public:
+  using state = std::uint32_t;
+
+  bool match(std::string_view s) const {
+    if (error != load_error::OK) {
+      return false;
+    }
+    state current = initial_state;
+    for (const char c : s) {
+      current = next(current, c);
+      if (current == dead_state) {
+        return false;
+      }
+    }
+    return is_accepting(current);
+  }
+
+  state next(state from, char c) const {
+    const auto byte_class = static_cast<unsigned char>(
+        classes[static_cast<unsigned char>(c)]);
+    return SerialImpl::get_u32(table + 4 * (from * class_count + byte_class));
+  }
+
+  bool is_accepting(state s) const { return accepting[s] != 0; }
+
+  size_t size = 0;
+  state initial_state = 0;
+  state dead_state = 0;
+  load_error error = load_error::OK;
+
+ private:
+  friend DFAView load_dfa(std::span<const char> bytes);
+
+  size_t class_count = 0;
+  const char* classes = nullptr;
+  const char* table = nullptr;
+  const char* accepting = nullptr;
+};
+
+namespace SerialImpl {
+
+// Checks the header and returns the state count through `size`.
+inline load_error check_header(std::span<const char> bytes,
+                               const std::array<char, 4>& magic,
+                               size_t& size) {
+  if (bytes.size() < header_size) {
+    return load_error::TRUNCATED;
+  }
+  if (!std::equal(magic.begin(), magic.end(), bytes.begin())) {
+    return load_error::BAD_MAGIC;
+  }
+  if (get_u32(bytes.data() + 4) != version) {
+    return load_error::BAD_VERSION;
+  }
+  size = get_u32(bytes.data() + 8);
+  return load_error::OK;
+}
+
+// Whether the `count` words of `array` are all below `limit`.
+inline bool all_below(const char* array, size_t count, size_t limit) {
+  for (size_t i = 0; i < count; ++i) {
+    if (get_u32(array + 4 * i) >= limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whether the `count + 1` offsets of `array` ascend from 0 to `total`.
+inline bool valid_offsets(const char* array, size_t count, size_t total) {
+  std::uint32_t previous = 0;
+  for (size_t i = 0; i <= count; ++i) {
+    const std::uint32_t offset = get_u32(array + 4 * i);
+    if (offset < previous || offset > total || (i == 0 && offset != 0)) {
+      return false;
+    }
+    previous = offset;
+  }
+  return previous == total;
+}
+
+}  // namespace SerialImpl
+
+/** Load an NFA blob in place. Errors are reported in `error`. */
+inline NFAView load_nfa(std::span<const char> bytes) {
+  using SerialImpl::get_u32;
+  NFAView view;
+  size_t size = 0;
+  view.error = SerialImpl::check_header(bytes, SerialImpl::nfa_magic, size);
+  if (view.error != load_error::OK) {
+    return view;
+  }
+  size_t offset = SerialImpl::header_size;
+  const char* fields = SerialImpl::take(bytes, offset, 4);
+  if (fields == nullptr) {
+    view.error = load_error::TRUNCATED;
+    return view;
+  }
+  const size_t edge_count = get_u32(fields + 8);
+  const size_t closure_count = get_u32(fields + 12);
+  view.edge_offsets = SerialImpl::take(bytes, offset, size + 1);
+  view.edge_targets = SerialImpl::take(bytes, offset, edge_count);
+  view.edge_labels = SerialImpl::take(bytes, offset, edge_count, 2);
+  view.closure_offsets = SerialImpl::take(bytes, offset, size + 1);
+  view.closures = SerialImpl::take(bytes, offset, closure_count);
+  if (view.edge_offsets == nullptr || view.edge_targets == nullptr ||
+      view.edge_labels == nullptr || view.closure_offsets == nullptr ||
+      view.closures == nullptr) {
+    view.error = load_error::TRUNCATED;
+    return view;
+  }
+  view.size = size;
+  view.initial_state = get_u32(fields);
+  view.final_state = get_u32(fields + 4);
+  if (view.initial_state >= size || view.final_state >= size ||
+      !SerialImpl::valid_offsets(view.edge_offsets, size, edge_count) ||
+      !SerialImpl::valid_offsets(view.closure_offsets, size, closure_count) ||
+      !SerialImpl::all_below(view.edge_targets, edge_count, size) ||
+      !SerialImpl::all_below(view.closures, closure_count, size)) {
+    view.error = load_error::BAD_STATE;
+  }
+  return view;
+}
+
+/** Load a DFA blob in place. Errors are reported in `error`. */
+inline DFAView load_dfa(std::span<const char> bytes) {
+  using SerialImpl::get_u32;
+  DFAView view;
+  size_t size = 0;
+  view.error = SerialImpl::check_header(bytes, SerialImpl::dfa_magic, size);
+  if (view.error != load_error::OK) {
+    return view;
+  }
+  size_t offset = SerialImpl::header_size;
+  const char* fields = SerialImpl::take(bytes, offset, 3);
+  view.classes =
+      SerialImpl::take(bytes, offset, ByteClasses::alphabet_size, 1);
+  if (fields == nullptr || view.classes == nullptr) {
+    view.error = load_error::TRUNCATED;
+    return view;
+  }
+  const size_t class_count = get_u32(fields + 8);
+  if (class_count == 0 || class_count > ByteClasses::alphabet_size ||
+      !std::all_of(view.classes, view.classes + ByteClasses::alphabet_size,
+                   [&](char c) {
+                     return static_cast<unsigned char>(c) < class_count;
+                   })) {
+    view.error = load_error::BAD_CLASS;
+    return view;
+  }
+  view.table = SerialImpl::take(bytes, offset, size * class_count);
+  view.accepting = SerialImpl::take(bytes, offset, size, 1);
+  if (view.table == nullptr || view.accepting == nullptr) {
+    view.error = load_error::TRUNCATED;
+    return view;
+  }
+  view.size = size;
+  view.class_count = class_count;
+  view.initial_state = get_u32(fields);
+  view.dead_state = get_u32(fields + 4);
+  if (view.initial_state >= size || view.dead_state >= size ||
+      !SerialImpl::all_below(view.table, size * class_count, size)) {
+    view.error = load_error::BAD_STATE;
+  }
+  return view;
+}
+
+}  // namespace RM::Impl
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "byte_set.hpp"
+#include "parser.hpp"
+
+namespace RM::Impl {
+
+// The size of a parse tree before and after `simplify`.
+struct SimplifyStats {
+  size_t nodes_before = 0;
+  size_t nodes_after = 0;
+  bool operator==(const SimplifyStats&) const = default;
+};
+
+namespace SimplifyImpl {
+
+/** Rebuilds a parse tree bottom-up into `out`, rewriting every node as it
+ * goes, so that the children of a node are always simplified already.
+ * Rewrites that drop nodes leave them unreachable in `out`, and `compact`
+ * keeps only the final tree.
+ */
+class Simplifier {
+ public:
+  using index = ParseNode::index;
+  using NodeType = ParseNode::NodeType;
+  // The factors of a concatenation, in order. Empty for the empty string.
+  using sequence = std::vector<index>;
+
+  constexpr explicit Simplifier(Parser::ParseResult& parse_result)
+      : parsed{parse_result} {}
+
+  constexpr index build(index i) {
+    const ParseNode node = parsed.nodes[static_cast<size_t>(i)];
+    switch (node.type) {
+      case NodeType::CHAR:
+      case NodeType::CLASS:
+        return add(node);
+      case NodeType::KLEENE_STAR:
+      case NodeType::ONE_OR_MORE:
+      case NodeType::OPTIONAL:
+        return unary(node.type, build(node.left));
+      case NodeType::CONCAT: {
+        // The right side is a chain already, reused as the tail so that a
+        // long concatenation is not copied once per level.
+        sequence items;
+        append_factors(build(node.left), items);
+        return concat(items, build(node.right));
+      }
+      case NodeType::OR: {
+        std::vector<sequence> alternatives;
+        collect_alternatives(i, alternatives);
+        return alternation(std::move(alternatives));
+      }
+    }
+    return -1;
+  }
+
+  // The number of nodes built so far, final or not.
+  constexpr size_t built() const { return out.size(); }
+
+  // Copy the tree of `root` out of `out` in post-order.
+  constexpr index compact(index root, std::vector<ParseNode>& result) const {
+    ParseNode node = out[static_cast<size_t>(root)];
+    if (node.left != -1) {
+      node.left = compact(node.left, result);
+    }
+    if (node.right != -1) {
+      node.right = compact(node.right, result);
+    }
+    result.push_back(node);
+    return static_cast<index>(result.size() - 1);
+  }
+
+ private:
+  static constexpr bool is_quantifier(NodeType type) {
+    return type == NodeType::KLEENE_STAR || type == NodeType::ONE_OR_MORE ||
+           type == NodeType::OPTIONAL;
+  }
+
+  constexpr const ParseNode& at(index i) const {
+    return out[static_cast<size_t>(i)];
+  }
+
+  constexpr index add(const ParseNode& node) {
+    bool is_nullable = false;
+    switch (node.type) {
+      case NodeType::KLEENE_STAR:
+      case NodeType::OPTIONAL:
+        is_nullable = true;
+        break;
+      case NodeType::ONE_OR_MORE:
+        is_nullable = nullable[static_cast<size_t>(node.left)] != 0;
+        break;
+      case NodeType::CONCAT:
+        is_nullable = nullable[static_cast<size_t>(node.left)] != 0 &&
+                      nullable[static_cast<size_t>(node.right)] != 0;
+        break;
+      case NodeType::OR:
+        is_nullable = nullable[static_cast<size_t>(node.left)] != 0 ||
+                      nullable[static_cast<size_t>(node.right)] != 0;
+        break;
+      default:
+        break;
+    }
+    out.push_back(node);
+    nullable.push_back(static_cast<char>(is_nullable));
+    return static_cast<index>(out.size() - 1);
+  }
+
+  constexpr index add_operator(NodeType type, index left, index right) {
+    return add(
+        {.left = left, .right = right, .type = type, .character = '\0'});
+  }
+
+  /**
+   * A quantifier of a quantifier is one of them: "(x*)*", "(x+)*", "(x?)*",
+   * "(x*)+", "(x?)+" and "(x+)?" are all "x*", "(x+)+" is "x+" and "(x?)?"
+   * is "x?". A nullable x makes "x?" just x and "x+" the same as "x*".
+   */
+  constexpr index unary(NodeType type, index child) {
+    const ParseNode& inner = at(child);
+    if (is_quantifier(inner.type)) {
+      return inner.type == type ? child
+                                : unary(NodeType::KLEENE_STAR, inner.left);
+    }
+    if (nullable[static_cast<size_t>(child)] != 0) {
+      if (type == NodeType::OPTIONAL) {
+        return child;
+      }
+      if (type == NodeType::ONE_OR_MORE) {
+        type = NodeType::KLEENE_STAR;
+      }
+    }
+    if (type != NodeType::OPTIONAL && inner.type == NodeType::OR) {
+      if (const index stripped = strip_alternatives(type, child);
+          stripped != -1) {
+        return unary(type, stripped);
+      }
+    }
+    return add_operator(type, child, -1);
+  }
+
+  /**
+   * Under a star, the quantifiers of the alternatives are redundant:
+   * "(x?|y)*", "(x*|y)*" and "(x+|y)*" are all "(x|y)*". Under a plus, only
+   * pluses are: "(x+|y)+" is "(x|y)+". The alternation without them, or -1
+   * if none of the alternatives has one.
+   */
+  constexpr index strip_alternatives(NodeType type, index i) {
+    std::vector<sequence> alternatives;
+    split_alternatives(i, alternatives);
+    bool stripped = false;
+    for (sequence& s : alternatives) {
+      const NodeType quantifier = at(s[0]).type;
+      if (s.size() == 1 && is_quantifier(quantifier) &&
+          (type == NodeType::KLEENE_STAR || quantifier == type)) {
+        const index inner = at(s[0]).left;
+        s.clear();
+        append_factors(inner, s);
+        stripped = true;
+      }
+    }
+    return stripped ? alternation(std::move(alternatives)) : -1;
+  }
+
+  constexpr void append_factors(index i, sequence& items) const {
+    if (at(i).type == NodeType::CONCAT) {
+      append_factors(at(i).left, items);
+      append_factors(at(i).right, items);
+    } else {
+      items.push_back(i);
+    }
+  }
+
+  // The factors as a right-leaning chain, like the parser builds it, ending
+  // with the chain `tail` if there is one.
+  constexpr index concat(const sequence& items, index tail = -1) {
+    size_t k = items.size();
+    index result = tail;
+    if (result == -1) {
+      result = items[--k];
+    }
+    while (k-- > 0) {
+      result = add_operator(NodeType::CONCAT, items[k], result);
+    }
+    return result;
+  }
+
+  // Flatten the alternatives of an OR of the input, built and split into
+  // their factors.
+  constexpr void collect_alternatives(index i,
+                                      std::vector<sequence>& alternatives) {
+    const ParseNode node = parsed.nodes[static_cast<size_t>(i)];
+    if (node.type == NodeType::OR) {
+      collect_alternatives(node.left, alternatives);
+      collect_alternatives(node.right, alternatives);
+      return;
+    }
+    const index built = build(i);
+    if (at(built).type == NodeType::OR) {
+      // A parenthesized alternation, possibly rewritten already.
+      split_alternatives(built, alternatives);
+      return;
+    }
+    alternatives.emplace_back();
+    append_factors(built, alternatives.back());
+  }
+
+  constexpr void split_alternatives(index i,
+                                    std::vector<sequence>& alternatives) {
+    if (at(i).type == NodeType::OR) {
+      split_alternatives(at(i).left, alternatives);
+      split_alternatives(at(i).right, alternatives);
+      return;
+    }
+    alternatives.emplace_back();
+    append_factors(i, alternatives.back());
+  }
+
+  constexpr bool same(index a, index b) const {
+    if (a == b) {
+      return true;
+    }
+    if (a == -1 || b == -1) {
+      return false;
+    }
+    const ParseNode& x = at(a);
+    const ParseNode& y = at(b);
+    if (x.type != y.type || x.character != y.character) {
+      return false;
+    }
+    if (x.type == NodeType::CLASS) {
+      return parsed.sets[static_cast<size_t>(x.set)] ==
+             parsed.sets[static_cast<size_t>(y.set)];
+    }
+    return same(x.left, y.left) && same(x.right, y.right);
+  }
+
+  constexpr bool same(const sequence& a, const sequence& b) const {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (size_t k = 0; k < a.size(); ++k) {
+      if (!same(a[k], b[k])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  constexpr bool is_byte_set(const sequence& items) const {
+    return items.size() == 1 && (at(items[0]).type == NodeType::CHAR ||
+                                 at(items[0]).type == NodeType::CLASS);
+  }
+
+  constexpr ByteSet bytes_of(index i) const {
+    const ParseNode& node = at(i);
+    return node.type == NodeType::CHAR
+               ? ByteSet::single(node.character)
+               : parsed.sets[static_cast<size_t>(node.set)];
+  }
+
+  /**
+   * Group the alternatives that start (or end, with `from_back`) with the
+   * same factor and factor it out: "abc|abd" is "a(bc|bd)", in turn
+   * "ab(c|d)". An alternative that is nothing but the factor makes the rest
+   * optional: "a|ab" is "a(b)?".
+   */
+  constexpr std::vector<sequence> factor(std::vector<sequence> alternatives,
+                                         bool from_back) {
+    const auto edge = [&](const sequence& s) {
+      return from_back ? s.back() : s.front();
+    };
+    std::vector<sequence> result;
+    std::vector<char> done(alternatives.size(), 0);
+    for (size_t k = 0; k < alternatives.size(); ++k) {
+      if (done[k] != 0) {
+        continue;
+      }
+      const index shared = edge(alternatives[k]);
+      std::vector<sequence> rests;
+      for (size_t j = k; j < alternatives.size(); ++j) {
+        if (done[j] == 0 && same(edge(alternatives[j]), shared)) {
+          done[j] = 1;
+          sequence rest = std::move(alternatives[j]);
+          rest.erase(from_back ? rest.end() - 1 : rest.begin());
+          rests.push_back(std::move(rest));
+        }
+      }
+      if (rests.size() == 1) {
+        sequence whole = std::move(rests[0]);
+        whole.insert(from_back ? whole.end() : whole.begin(), shared);
+        result.push_back(std::move(whole));
+        continue;
+      }
+      sequence merged;
+      append_factors(alternation(std::move(rests)), merged);
+      merged.insert(from_back ? merged.end() : merged.begin(), shared);
+      result.push_back(std::move(merged));
+    }
+    return result;
+  }
+
+  /**
+   * Build the alternation of `alternatives`, at least one of which is not
+   * empty. Duplicates are dropped, alternatives that are single characters
+   * or classes are merged into one class, and shared first and last
+   * factors are factored out. An empty alternative makes the whole
+   * alternation optional.
+   */
+  constexpr index alternation(std::vector<sequence> alternatives) {
+    bool optional = false;
+    std::vector<sequence> unique;
+    for (sequence& s : alternatives) {
+      if (s.empty()) {
+        optional = true;
+        continue;
+      }
+      bool seen = false;
+      for (const sequence& u : unique) {
+        seen = seen || same(s, u);
+      }
+      if (!seen) {
+        unique.push_back(std::move(s));
+      }
+    }
+
+    std::vector<sequence> rest;
+    ByteSet merged;
+    index first_byte_set = -1;
+    size_t byte_sets = 0;
+    for (sequence& s : unique) {
+      if (is_byte_set(s)) {
+        merged.insert_all(bytes_of(s[0]));
+        if (byte_sets++ == 0) {
+          first_byte_set = s[0];
+        }
+      } else {
+        rest.push_back(std::move(s));
+      }
+    }
+    if (byte_sets == 1) {
+      rest.push_back({first_byte_set});
+    } else if (byte_sets > 1) {
+      parsed.sets.push_back(merged);
+      rest.push_back({add({.left = -1,
+                           .right = -1,
+                           .type = NodeType::CLASS,
+                           .character = '\0',
+                           .set = static_cast<index>(parsed.sets.size() -
+                                                     1)})});
+    }
+
+    rest = factor(factor(std::move(rest), false), true);
+    index result = concat(rest.back());
+    for (size_t k = rest.size() - 1; k-- > 0;) {
+      result = add_operator(NodeType::OR, concat(rest[k]), result);
+    }
+    return optional ? unary(NodeType::OPTIONAL, result) : result;
+  }
+
+  Parser::ParseResult& parsed;
+  std::vector<ParseNode> out;
+  // Whether each node of `out` matches the empty string, as 0 or 1.
+  std::vector<char> nullable;
+};
+
+}  // namespace SimplifyImpl
+
+/**
+ * Rewrite a parse tree into a smaller one that matches the same strings.
+ *
+ * Nested quantifiers become one, "(a*)*" and "(a?)*" being "a*". Duplicate
+ * alternatives are dropped, single-character alternatives are merged into a
+ * class, "a|b|c" being "[abc]", and the first and last factors alternatives
+ * share are factored out, "abc|abd" being "ab[cd]". Fewer nodes mean fewer
+ * states and epsilon edges in every automaton built from the tree.
+ * Leaves a tree with an error as it is. Usable at compile time.
+ */
+constexpr SimplifyStats simplify(Parser::ParseResult& parsed) {
+  SimplifyStats stats{.nodes_before = parsed.nodes.size(),
+                      .nodes_after = parsed.nodes.size()};
+  if (!parsed.err_msg.empty() || parsed.nodes.empty()) {
+    return stats;
+  }
+  SimplifyImpl::Simplifier simplifier{parsed};
+  const ParseNode::index root = simplifier.build(parsed.first_node);
+  std::vector<ParseNode> nodes;
+  parsed.first_node = simplifier.compact(root, nodes);
+  parsed.nodes = std::move(nodes);
+  stats.nodes_after = parsed.nodes.size();
+  return stats;
+}
+
+}  // namespace RM::Impl
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace RM::Impl {
+
+/** A fixed-width set of NFA states backed by 64-bit words.
+ * The width is chosen once, so inserting, clearing and iterating never
+ * allocate and the same sets can be reused for a whole match.
+ * It is constexpr so that position sets can be computed at compile time.
+ */
+class StateBitset {
+ public:
+  using word = std::uint64_t;
+  static constexpr size_t word_bits = 64;
+
+  constexpr StateBitset() = default;
+  constexpr explicit StateBitset(size_t n)
+      : words((n + word_bits - 1) / word_bits, 0) {}
+
+  constexpr void insert(size_t i) {
+    words[i / word_bits] |= word{1} << (i % word_bits);
+  }
+
+  constexpr void erase(size_t i) {
+    words[i / word_bits] &= ~(word{1} << (i % word_bits));
+  }
+
+  constexpr bool contains(size_t i) const {
+    return ((words[i / word_bits] >> (i % word_bits)) & word{1}) != 0;
+  }
+
+  // Both sets must have the same width.
+  constexpr void insert_all(const StateBitset& other) {
+    for (size_t i = 0; i < words.size(); ++i) {
+      words[i] |= other.words[i];
+    }
+  }
+
+  constexpr void clear() {
+    for (word& w : words) {
+      w = 0;
+    }
+  }
+
+  constexpr bool empty() const {
+    for (const word w : words) {
+      if (w != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  constexpr size_t count() const {
+    size_t result = 0;
+    for (const word w : words) {
+      result += static_cast<size_t>(std::popcount(w));
+    }
+    return result;
+  }
+
+  template <typename F>
+  constexpr void for_each(F&& f) const {
+    for (size_t i = 0; i < words.size(); ++i) {
+      for (word w = words[i]; w != 0; w &= w - 1) {
+        f(i * word_bits + static_cast<size_t>(std::countr_zero(w)));
+      }
+    }
+  }
+
+  bool operator==(const StateBitset&) const = default;
+
+  std::vector<word> words;
+};
+
+// A hash of the words of a StateBitset, for maps keyed by sets of states.
+struct words_hash {
+  size_t operator()(const std::vector<StateBitset::word>& words) const {
+    size_t h = 0;
+    for (const StateBitset::word w : words) {
+      h ^= std::hash<StateBitset::word>{}(w) + 0x9e3779b97f4a7c15ULL +
+           (h << 6U) + (h >> 2U);
+    }
+    return h;
+  }
+};
+
+}  // namespace RM::Impl
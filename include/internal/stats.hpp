@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+namespace RM::Impl {
+
+/** Counters of the work done while matching, summed over the matches they
+ * were collected from. Divide by `matches` or `bytes` for averages.
+ */
+struct MatchStats {
+  size_t matches = 0;
+  // Input bytes read. A match that fails early stops reading.
+  size_t bytes = 0;
+  // The number of active automaton states after every byte read, summed, and
+  // the largest one. A DFA always has one.
+  size_t active_states = 0;
+  size_t max_active_states = 0;
+  // Epsilon-closures of single NFA states added to an active set.
+  size_t closure_expansions = 0;
+  // Heap allocations of state sets, scratch space and lazy DFA states.
+  size_t allocations = 0;
+  // Lazy DFA transitions found in its cache, and computed because they were
+  // not there.
+  size_t cache_hits = 0;
+  size_t cache_misses = 0;
+
+  MatchStats& operator+=(const MatchStats& other) {
+    matches += other.matches;
+    bytes += other.bytes;
+    active_states += other.active_states;
+    max_active_states = std::max(max_active_states, other.max_active_states);
+    closure_expansions += other.closure_expansions;
+    allocations += other.allocations;
+    cache_hits += other.cache_hits;
+    cache_misses += other.cache_misses;
+    return *this;
+  }
+
+  bool operator==(const MatchStats&) const = default;
+};
+
+/** Statistics policies of the engines' match functions.
+ *
+ * The engines report events to a policy object passed by reference. NoStats
+ * ignores them and compiles away entirely, so a match without statistics is
+ * the same code as before they existed. CountStats adds them up into a
+ * MatchStats. Whatever is costly to compute, like the size of an active set,
+ * is only computed when `enabled` is true.
+ */
+struct NoStats {
+  static constexpr bool enabled = false;
+  constexpr void read(size_t /*unused*/) {}
+  constexpr void active(size_t /*unused*/) {}
+  constexpr void closure(size_t /*unused*/) {}
+  constexpr void allocated(size_t /*unused*/) {}
+  constexpr void cache_hit() {}
+  constexpr void cache_miss() {}
+};
+
+struct CountStats {
+  static constexpr bool enabled = true;
+  void read(size_t n) { stats.bytes += n; }
+  void active(size_t n) {
+    stats.active_states += n;
+    stats.max_active_states = std::max(stats.max_active_states, n);
+  }
+  void closure(size_t n) { stats.closure_expansions += n; }
+  void allocated(size_t n) { stats.allocations += n; }
+  void cache_hit() { ++stats.cache_hits; }
+  void cache_miss() { ++stats.cache_misses; }
+
+  MatchStats& stats;
+};
+
+/** A MatchStats that many threads add to at once. */
+class SharedStats {
+ public:
+  void add(const MatchStats& other) {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    matches.fetch_add(other.matches, relaxed);
+    bytes.fetch_add(other.bytes, relaxed);
+    active_states.fetch_add(other.active_states, relaxed);
+    size_t max = max_active_states.load(relaxed);
+    while (max < other.max_active_states &&
+           !max_active_states.compare_exchange_weak(
+               max, other.max_active_states, relaxed)) {
+    }
+    closure_expansions.fetch_add(other.closure_expansions, relaxed);
+    allocations.fetch_add(other.allocations, relaxed);
+    cache_hits.fetch_add(other.cache_hits, relaxed);
+    cache_misses.fetch_add(other.cache_misses, relaxed);
+  }
+
+  // The counters are read one by one, so a snapshot taken while matches run
+  // may be mid-way through adding one of them.
+  MatchStats snapshot() const {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    return {
+        .matches = matches.load(relaxed),
+        .bytes = bytes.load(relaxed),
+        .active_states = active_states.load(relaxed),
+        .max_active_states = max_active_states.load(relaxed),
+        .closure_expansions = closure_expansions.load(relaxed),
+        .allocations = allocations.load(relaxed),
+        .cache_hits = cache_hits.load(relaxed),
+        .cache_misses = cache_misses.load(relaxed),
+    };
+  }
+
+ private:
+  std::atomic<size_t> matches{0};
+  std::atomic<size_t> bytes{0};
+  std::atomic<size_t> active_states{0};
+  std::atomic<size_t> max_active_states{0};
+  std::atomic<size_t> closure_expansions{0};
+  std::atomic<size_t> allocations{0};
+  std::atomic<size_t> cache_hits{0};
+  std::atomic<size_t> cache_misses{0};
+};
+
+}  // namespace RM::Impl
@@ -1,26 +1,801 @@
 #pragma once
 
+#include <concepts>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "internal/bitap.hpp"
+#include "internal/dfa.hpp"
+#include "internal/fixed_string.hpp"
+#include "internal/glushkov.hpp"
+#include "internal/input.hpp"
+#include "internal/lazy_dfa.hpp"
 #include "internal/nfa.hpp"
 #include "internal/nfa_creation.hpp"
+#include "internal/parallel.hpp"
 #include "internal/parser.hpp"
+#include "internal/prefix.hpp"
+#include "internal/regex_set.hpp"
+#include "internal/search.hpp"
+#include "internal/serialize.hpp"
+#include "internal/simplify.hpp"
+#include "internal/stats.hpp"
 
 namespace RM {
 
+/** The simulation used by `Matcher::match`.
+ * AUTO - BITAP when the pattern fits into it, NFA_BITSET otherwise.
+ * NFA - the reference simulation over hash sets of states.
+ * NFA_BITSET - the same simulation over preallocated state bitsets.
+ * LAZY_DFA - a DFA built on demand from the visited NFA state sets and cached
+ *   in the matcher between calls. A matcher using it must not be shared
+ *   between threads without synchronization.
+ * DFA - a minimal DFA compiled ahead of time when the matcher is built.
+ *   Compiling fails with an error if it needs more than `dfa_state_limit`
+ *   states before minimization.
+ * BITAP - bit-parallel simulation of the position automaton in one machine
+ *   word. Compiling fails with an error for more than 64 characters.
+ */
+enum class Engine {
+  AUTO,
+  NFA,
+  NFA_BITSET,
+  LAZY_DFA,
+  DFA,
+  BITAP,
+};
+
+// What the lazy DFA does when its cache is full: clear it and keep building,
+// or match the rest of the input by NFA simulation.
+using CacheOverflow = Impl::LazyDFA::overflow;
+
+// How the NFA behind every engine is built from the pattern, see
+// Impl::construction.
+using Construction = Impl::construction;
+
+// A match found by `Matcher::find`, as the half-open range [begin, end).
+using Span = Impl::Span;
+
+// Counters of the work done by `Matcher::match`, see Impl::MatchStats.
+using MatchStats = Impl::MatchStats;
+
+// The parse tree size before and after simplification, see Impl::simplify.
+using SimplifyStats = Impl::SimplifyStats;
+
+/** What `Matcher::match` reads in place, next to everything convertible to
+ * std::string_view: any other multi-pass range of chars, contiguous or not
+ * (std::span<const char>, std::deque<char>...), and ranges of chunks read as
+ * one input (std::vector<std::string_view>, rope segments, iovecs mapped to
+ * std::string_view...). See Impl::CharRange and Impl::ChunkedInput.
+ */
+template <typename R>
+concept MatchInput = (Impl::CharRange<R> || Impl::ChunkedInput<R>) &&
+                     !std::convertible_to<const R&, std::string_view>;
+
+struct Options {
+  Engine engine = Engine::AUTO;
+  Construction construction = Construction::THOMPSON;
+  size_t lazy_dfa_cache_limit = Impl::LazyDFA::default_cache_limit;
+  CacheOverflow lazy_dfa_overflow = CacheOverflow::CLEAR;
+  size_t dfa_state_limit = 10000;
+  // Sum up the MatchStats of every `match` call, for `Matcher::stats`.
+  bool collect_stats = false;
+  // Rewrite the parse tree into a smaller equivalent one before building
+  // the automata, see `Matcher::simplify_stats`.
+  bool simplify = true;
+  // Never match '\n', even where the pattern reads it, like "[^a]", so
+  // that no match runs across lines.
+  bool never_newline = false;
+  bool operator==(const Options&) const = default;
+};
+
 class Matcher {
+  struct Program;
+
  public:
-  explicit Matcher(std::string&& input)
-      : nfa{Impl::create_from_str(std::move(input), err_msg)} {}
+  explicit Matcher(std::string_view pattern, Options opts = {})
+      : Matcher{compile(Impl::Parser{std::string{pattern}}.parse(), opts)} {}
+
+  /**
+   * Whether the whole `input` matches. The input is read in place, so
+   * nothing is copied or allocated for it.
+   */
+  bool match(std::string_view input) const { return match_input(input); }
+
+  template <MatchInput R>
+  bool match(const R& input) const {
+    return match_input(input);
+  }
+
+  /**
+   * Same as `match`, and add the work it does to `stats`, whether or not
+   * the matcher collects statistics itself.
+   */
+  bool match(std::string_view input, MatchStats& stats) const {
+    return match_input(input, stats);
+  }
+
+  template <MatchInput R>
+  bool match(const R& input, MatchStats& stats) const {
+    return match_input(input, stats);
+  }
+
+  /**
+   * The statistics of every `match` call so far, summed, if the matcher was
+   * built with `collect_stats`, and all zero otherwise. `match_parallel`,
+   * `match_batch` and sessions are not counted. Copies of a matcher add to
+   * the same statistics. Safe to call while other threads match.
+   */
+  MatchStats stats() const {
+    return collected ? collected->snapshot() : MatchStats{};
+  }
+
+  /**
+   * The node count of the pattern's parse tree as written and as compiled.
+   * Both are the same if the matcher was built without `simplify`.
+   */
+  SimplifyStats simplify_stats() const { return program->simplified; }
+
+  /**
+   * Match one long `input` on up to `threads` threads, all cores if 0.
+   *
+   * The input is split into one chunk per thread. Every chunk but the first
+   * is run from all automaton states at once, and the results are composed
+   * in order. This scales when the automaton soon forgets the state a chunk
+   * started in, as most do. Only the DFA and BITAP engines run in parallel;
+   * the others, and inputs too short to split, are matched on this thread.
+   * Whichever way it runs, it is not counted in `stats`.
+   */
+  bool match_parallel(std::string_view input, size_t threads = 0) const {
+    if (!err_msg.empty() || !input.starts_with(program->prefix.literal)) {
+      return false;
+    }
+    switch (program->engine) {
+      case Engine::DFA:
+        return Impl::match_parallel(program->dfa, input, threads);
+      case Engine::BITAP:
+        return Impl::match_parallel(*program->bitap, input, threads);
+      default: {
+        Impl::NoStats none;
+        return run_match(input, none);
+      }
+    }
+  }
+
+  /**
+   * Match every input, writing whether `inputs[i]` matches to `results[i]`,
+   * on up to `threads` threads, all cores if 0. `results` must be at least
+   * as long as `inputs`.
+   *
+   * Every thread matches through one Session, reset between inputs, so
+   * nothing is allocated per input and a LAZY_DFA cache is kept per thread.
+   * Idle threads steal inputs from busy ones. Not counted in `stats`.
+   */
+  void match_batch(std::span<const std::string_view> inputs,
+                   std::span<bool> results, size_t threads = 0) const {
+    Impl::for_each_index(inputs.size(), threads, [&]() {
+      return [this, inputs, results, session = Session{*this}](
+                 size_t i) mutable {
+        const std::string_view input = inputs[i];
+        if (!input.starts_with(program->prefix.literal)) {
+          results[i] = false;
+          return;
+        }
+        session.reset();
+        session.feed(input);
+        results[i] = session.finish();
+      };
+    });
+  }
+
+  /**
+   * Find the leftmost-longest match anywhere in `input`.
+   * Searching always simulates the NFA, whatever the engine, so it finds
+   * nothing only if the pattern itself is invalid.
+   */
+  std::optional<Span> find(std::string_view input) const {
+    return Impl::Searcher{program->nfa, program->prefix}.find(input, 0);
+  }
 
-  bool match(std::string&& input) const {
-    return err_msg.empty() ? nfa.match(input) : false;
+  /**
+   * Iterate over the non-overlapping leftmost-longest matches in `input`.
+   * The matcher and the input must outlive the returned range.
+   */
+  Impl::Matches find_all(std::string_view input) const {
+    return {program->nfa, program->prefix, input};
+  }
+
+  /** A resumable match over input that arrives in chunks.
+   *
+   * The automaton state is kept between `feed` calls, so no past input is
+   * buffered. `feed` returns false as soon as no further input can make the
+   * whole input match, and `finish` gives the verdict for everything fed so
+   * far. The DFA and BITAP engines step their own state and LAZY_DFA steps a
+   * cache owned by the session, which `reset` keeps. The other engines step
+   * the NFA over bitsets. The matcher must outlive the session.
+   */
+  class Session {
+   public:
+    explicit Session(const Matcher& owner)
+        : program{owner.program.get()},
+          lazy_dfa{program->options.lazy_dfa_cache_limit,
+                   program->options.lazy_dfa_overflow} {
+      if (program->engine != Engine::BITAP &&
+          program->engine != Engine::DFA) {
+        current = Impl::StateBitset{program->nfa.size};
+        next = Impl::StateBitset{program->nfa.size};
+        stack.reserve(program->nfa.size);
+      }
+      reset();
+    }
+
+    // Start over with empty input, reusing the allocated state.
+    void reset() {
+      dead = !program->err_msg.empty();
+      started = false;
+      bits = 0;
+      dfa_state = program->dfa.initial_state;
+      on_nfa = program->engine != Engine::BITAP &&
+               program->engine != Engine::DFA &&
+               program->engine != Engine::LAZY_DFA;
+      if (dead) {
+        return;
+      }
+      if (program->engine == Engine::LAZY_DFA) {
+        lazy_state = lazy_dfa.start_state(program->nfa);
+      } else if (on_nfa) {
+        current.clear();
+        program->nfa.add_closure(current, program->nfa.initial_state, stack);
+      }
+    }
+
+    bool feed(std::string_view chunk) {
+      if (dead) {
+        return false;
+      }
+      if (on_nfa) {
+        feed_nfa(chunk);
+      } else if (program->engine == Engine::BITAP) {
+        feed_bitap(chunk);
+      } else if (program->engine == Engine::DFA) {
+        feed_dfa(chunk);
+      } else {
+        feed_lazy_dfa(chunk);
+      }
+      return !dead;
+    }
+
+    bool finish() const {
+      if (dead) {
+        return false;
+      }
+      if (on_nfa) {
+        return current.contains(program->nfa.final_state);
+      }
+      switch (program->engine) {
+        case Engine::BITAP:
+          return started ? (bits & program->bitap->last) != 0
+                         : program->bitap->nullable;
+        case Engine::DFA:
+          return program->dfa.accepting[dfa_state] != 0;
+        default:
+          return lazy_dfa.is_accepting(lazy_state);
+      }
+    }
+
+    // Whether the input can no longer match, whatever comes next.
+    bool is_dead() const { return dead; }
+
+   private:
+    void feed_bitap(std::string_view chunk) {
+      for (const char c : chunk) {
+        bits = program->bitap->next(bits, !started, c);
+        started = true;
+        if (bits == 0) {
+          dead = true;
+          return;
+        }
+      }
+    }
+
+    void feed_dfa(std::string_view chunk) {
+      for (const char c : chunk) {
+        dfa_state = program->dfa.next(dfa_state, c);
+        if (dfa_state == program->dfa.dead_state) {
+          dead = true;
+          return;
+        }
+      }
+    }
+
+    // Once a new state does not fit into the cache under the FALLBACK
+    // policy, the rest of the input goes to the NFA.
+    void feed_lazy_dfa(std::string_view chunk) {
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        const Impl::LazyDFA::dstate to =
+            lazy_dfa.next(program->nfa, lazy_state, chunk[i]);
+        if (to == Impl::LazyDFA::UNKNOWN) [[unlikely]] {
+          current = lazy_dfa.states_of(lazy_state);
+          on_nfa = true;
+          feed_nfa(chunk.substr(i));
+          return;
+        }
+        if (to == Impl::LazyDFA::DEAD) {
+          dead = true;
+          return;
+        }
+        lazy_state = to;
+      }
+    }
+
+    void feed_nfa(std::string_view chunk) {
+      for (const char c : chunk) {
+        program->nfa.step(current, c, next, stack);
+        std::swap(current, next);
+        if (current.empty()) {
+          dead = true;
+          return;
+        }
+      }
+    }
+
+    const Program* program;
+    Impl::LazyDFA lazy_dfa;
+    Impl::StateBitset current;
+    Impl::StateBitset next;
+    std::vector<Impl::NFA::state> stack;
+    Impl::LazyDFA::dstate lazy_state = Impl::LazyDFA::DEAD;
+    Impl::DFA::state dfa_state{};
+    Impl::Bitap::mask bits = 0;
+    bool started = false;
+    bool on_nfa = false;
+    bool dead = false;
+  };
+
+  Session session() const { return Session{*this}; }
+
+  /**
+   * The compiled automaton as a blob for `LoadedMatcher`, so that other
+   * processes can map it from a file instead of compiling the pattern: the
+   * DFA for the DFA engine and the NFA for the others. Empty if the pattern
+   * is invalid or its NFA has no precomputed closures, see
+   * Impl::NFA::closure_budget.
+   */
+  std::vector<char> save() const {
+    if (!err_msg.empty()) {
+      return {};
+    }
+    return program->engine == Engine::DFA ? Impl::save(program->dfa)
+                                          : Impl::save(program->nfa);
   }
 
   std::string err_msg;
 
  private:
-  Impl::NFA nfa;
+  friend class MatcherCache;
+
+  // Everything compiled from a pattern. It is never modified once built, so
+  // it is shared by the copies of a matcher and by MatcherCache.
+  struct Program {
+    Options options;
+    // The engine actually used, with AUTO resolved.
+    Engine engine;
+    // Only built for the BITAP engine, as its tables take 18 KiB.
+    std::unique_ptr<const Impl::Bitap> bitap;
+    Impl::Prefix prefix;
+    Impl::NFA nfa;
+    Impl::DFA dfa;
+    Impl::SimplifyStats simplified;
+    std::string err_msg;
+  };
+
+  explicit Matcher(std::shared_ptr<const Program> compiled)
+      : err_msg{compiled->err_msg},
+        program{std::move(compiled)},
+        lazy_dfa{program->options.lazy_dfa_cache_limit,
+                 program->options.lazy_dfa_overflow} {
+    if (program->options.collect_stats) {
+      collected = std::make_shared<Impl::SharedStats>();
+    }
+  }
+
+  template <typename Input>
+  bool match_input(const Input& input) const {
+    if (collected) [[unlikely]] {
+      MatchStats stats;
+      const bool result = match_input(input, stats);
+      collected->add(stats);
+      return result;
+    }
+    Impl::NoStats none;
+    return run_match(input, none);
+  }
+
+  template <typename Input>
+  bool match_input(const Input& input, MatchStats& stats) const {
+    ++stats.matches;
+    Impl::CountStats counting{stats};
+    return run_match(input, counting);
+  }
+
+  // Chunks are read through a joined view and contiguous ranges as
+  // std::string_view, so the engines are only instantiated for those and
+  // for other, non-contiguous, ranges.
+  template <typename Input, typename Stats>
+  bool run_match(const Input& input, Stats& stats) const {
+    if constexpr (Impl::ChunkedInput<Input>) {
+      return run_engine(Impl::JoinedChunks<Input>{input}, stats);
+    } else if constexpr (std::ranges::contiguous_range<Input> &&
+                         std::ranges::sized_range<Input>) {
+      return run_engine(
+          std::string_view{std::ranges::data(input), std::ranges::size(input)},
+          stats);
+    } else {
+      return run_engine(input, stats);
+    }
+  }
+
+  // Instantiated with Impl::NoStats, this is the plain match with no
+  // counting at all.
+  template <Impl::CharRange R, typename Stats>
+  bool run_engine(const R& input, Stats& stats) const {
+    if (!err_msg.empty() ||
+        !Impl::starts_with(input, program->prefix.literal)) {
+      return false;
+    }
+    switch (program->engine) {
+      case Engine::NFA_BITSET:
+        return program->nfa.match_bitset(input, stats);
+      case Engine::LAZY_DFA:
+        return lazy_dfa.match(program->nfa, input, stats);
+      case Engine::DFA:
+        return program->dfa.match(input, stats);
+      case Engine::BITAP:
+        return program->bitap->match(input, stats);
+      case Engine::AUTO:
+      case Engine::NFA:
+      default:
+        return program->nfa.match(input, stats);
+    }
+  }
+
+  static std::shared_ptr<const Program> compile(
+      Impl::Parser::ParseResult&& parsed, Options opts) {
+    if (opts.never_newline) {
+      drop_newline(parsed);
+    }
+    const Impl::SimplifyStats simplified =
+        opts.simplify ? Impl::simplify(parsed)
+                      : Impl::SimplifyStats{.nodes_before = parsed.nodes.size(),
+                                            .nodes_after = parsed.nodes.size()};
+    auto result = std::make_shared<Program>(Program{
+        .options = opts,
+        .engine = opts.engine,
+        .bitap = {},
+        .prefix = Impl::create_prefix(parsed),
+        .nfa = Impl::NFA{0, {0, 0}},
+        .dfa = {},
+        .simplified = simplified,
+        .err_msg = {},
+    });
+    Program& p = *result;
+    auto bitap = uses_bitap(opts.engine)
+                     ? std::make_unique<Impl::Bitap>(Impl::create_bitap(parsed))
+                     : nullptr;
+    p.nfa = Impl::create_nfa(std::move(parsed), p.err_msg, opts.construction);
+    if (!p.err_msg.empty()) {
+      return result;
+    }
+    if (p.engine == Engine::AUTO) {
+      p.engine = bitap->error == Impl::Bitap::err_state::OK
+                     ? Engine::BITAP
+                     : Engine::NFA_BITSET;
+    }
+    if (p.engine == Engine::BITAP) {
+      if (bitap->error == Impl::Bitap::err_state::TOO_MANY_POSITIONS) {
+        p.err_msg = "too many characters for the bit-parallel engine";
+      }
+      p.bitap = std::move(bitap);
+    }
+    if (p.engine == Engine::DFA) {
+      p.dfa = Impl::minimize(Impl::create_dfa(p.nfa, opts.dfa_state_limit));
+      if (p.dfa.error == Impl::DFA::err_state::TOO_MANY_STATES) {
+        p.err_msg = "DFA state limit exceeded";
+      }
+    }
+    return result;
+  }
+
+  // Make the characters and classes of `parsed` read no '\n'. A '\n'
+  // character becomes an empty class, which reads nothing.
+  static void drop_newline(Impl::Parser::ParseResult& parsed) {
+    using NodeType = Impl::ParseNode::NodeType;
+    for (Impl::ParseNode& node : parsed.nodes) {
+      if (node.type == NodeType::CLASS) {
+        parsed.sets[static_cast<size_t>(node.set)].erase('\n');
+      } else if (node.type == NodeType::CHAR && node.character == '\n') {
+        parsed.sets.emplace_back();
+        node.type = NodeType::CLASS;
+        node.character = '\0';
+        node.set = static_cast<Impl::ParseNode::index>(parsed.sets.size() - 1);
+      }
+    }
+  }
+
+  static bool uses_bitap(Engine engine) {
+    return engine == Engine::AUTO || engine == Engine::BITAP;
+  }
+
+  std::shared_ptr<const Program> program;
+  mutable Impl::LazyDFA lazy_dfa;
+  // Null unless the options ask for statistics.
+  std::shared_ptr<Impl::SharedStats> collected;
+};
+
+/** A thread-safe, bounded cache of compiled patterns, keyed by the pattern
+ * and its options.
+ *
+ * `get` returns a matcher that shares the cached compiled program, so a hit
+ * costs a lookup and a reference count increment instead of a parse and NFA
+ * build. Every returned matcher still has its own LAZY_DFA cache. When more
+ * than `capacity` patterns are cached, the least recently used one is
+ * dropped; matchers already handed out keep it alive. Invalid patterns are
+ * cached too, with their `err_msg`.
+ */
+class MatcherCache {
+ public:
+  struct Stats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    bool operator==(const Stats&) const = default;
+  };
+
+  static constexpr size_t default_capacity = 4096;
+
+  explicit MatcherCache(size_t max_entries = default_capacity)
+      : capacity{max_entries} {}
+
+  // The cache shared by the whole process.
+  static MatcherCache& global() {
+    static MatcherCache cache;
+    return cache;
+  }
+
+  Matcher get(const std::string& pattern, Options opts = {}) {
+    key k{.pattern = pattern, .options = opts};
+    {
+      const std::lock_guard<std::mutex> guard{lock};
+      if (const auto it = index.find(k); it != index.end()) {
+        ++counters.hits;
+        entries.splice(entries.begin(), entries, it->second);
+        return Matcher{it->second->second};
+      }
+      ++counters.misses;
+    }
+    // Compile without holding the lock. If another thread compiled the same
+    // pattern meanwhile, its program is kept and this one is dropped.
+    std::shared_ptr<const Matcher::Program> compiled =
+        Matcher::compile(Impl::Parser{pattern}.parse(), opts);
+    const std::lock_guard<std::mutex> guard{lock};
+    if (const auto it = index.find(k); it != index.end()) {
+      entries.splice(entries.begin(), entries, it->second);
+      return Matcher{it->second->second};
+    }
+    if (capacity == 0) {
+      return Matcher{std::move(compiled)};
+    }
+    if (entries.size() == capacity) {
+      index.erase(entries.back().first);
+      entries.pop_back();
+      ++counters.evictions;
+    }
+    entries.emplace_front(k, compiled);
+    index.emplace(std::move(k), entries.begin());
+    return Matcher{std::move(compiled)};
+  }
+
+  Stats stats() const {
+    const std::lock_guard<std::mutex> guard{lock};
+    return counters;
+  }
+
+  size_t size() const {
+    const std::lock_guard<std::mutex> guard{lock};
+    return entries.size();
+  }
+
+  void clear() {
+    const std::lock_guard<std::mutex> guard{lock};
+    entries.clear();
+    index.clear();
+  }
+
+ private:
+  struct key {
+    std::string pattern;
+    Options options;
+    bool operator==(const key&) const = default;
+  };
+
+  struct key_hash {
+    size_t operator()(const key& k) const {
+      size_t h = std::hash<std::string>{}(k.pattern);
+      const auto mix = [&h](size_t v) {
+        h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U);
+      };
+      mix(static_cast<size_t>(k.options.engine));
+      mix(static_cast<size_t>(k.options.construction));
+      mix(k.options.lazy_dfa_cache_limit);
+      mix(static_cast<size_t>(k.options.lazy_dfa_overflow));
+      mix(k.options.dfa_state_limit);
+      mix(static_cast<size_t>(k.options.collect_stats));
+      mix(static_cast<size_t>(k.options.simplify));
+      mix(static_cast<size_t>(k.options.never_newline));
+      return h;
+    }
+  };
+
+  // Most recently used first.
+  using entry_list =
+      std::list<std::pair<key, std::shared_ptr<const Matcher::Program>>>;
+
+  size_t capacity;
+  mutable std::mutex lock;
+  entry_list entries;
+  std::unordered_map<key, entry_list::iterator, key_hash> index;
+  Stats counters{.hits = 0, .misses = 0, .evictions = 0};
+};
+
+/** A matcher read in place from a blob made by `Matcher::save`, such as an
+ * mmap'd file, so nothing is parsed, compiled or copied. The blob must
+ * outlive the matcher. A DFA blob is matched with the DFA and an NFA blob by
+ * simulating the NFA over bitsets kept in the matcher, so, as with the
+ * LAZY_DFA engine, a matcher must not be shared between threads without
+ * synchronization; copies are cheap. If the blob is not valid, `err_msg`
+ * says why and nothing matches.
+ */
+class LoadedMatcher {
+ public:
+  explicit LoadedMatcher(std::span<const char> blob) {
+    using Impl::load_error;
+    const auto& dfa_magic = Impl::SerialImpl::dfa_magic;
+    is_dfa = blob.size() >= dfa_magic.size() &&
+             std::equal(dfa_magic.begin(), dfa_magic.end(), blob.begin());
+    const load_error error = is_dfa ? (dfa = Impl::load_dfa(blob)).error
+                                    : (nfa = Impl::load_nfa(blob)).error;
+    switch (error) {
+      case load_error::OK:
+        break;
+      case load_error::TRUNCATED:
+        err_msg = "truncated blob";
+        break;
+      case load_error::BAD_MAGIC:
+        err_msg = "not a saved matcher";
+        break;
+      case load_error::BAD_VERSION:
+        err_msg = "unsupported blob version";
+        break;
+      case load_error::BAD_STATE:
+      case load_error::BAD_CLASS:
+      default:
+        err_msg = "corrupt blob";
+        break;
+    }
+  }
+
+  bool match(std::string_view input) const {
+    if (!err_msg.empty()) {
+      return false;
+    }
+    return is_dfa ? dfa.match(input) : nfa.match(input, scratch);
+  }
+
+  std::string err_msg;
+
+ private:
+  bool is_dfa = false;
+  Impl::NFAView nfa;
+  Impl::DFAView dfa;
+  mutable Impl::NFAView::Scratch scratch;
+};
+
+/** Many patterns matched in a single pass over the input.
+ * The patterns are joined into one automaton, and `match` returns the
+ * indices of all patterns that match the whole input, in increasing order.
+ * If a pattern is invalid, `err_msg` names it and nothing matches.
+ */
+class RegexSet {
+ public:
+  explicit RegexSet(const std::vector<std::string>& patterns) {
+    std::vector<Impl::Parser::ParseResult> parsed;
+    parsed.reserve(patterns.size());
+    for (size_t k = 0; k < patterns.size(); ++k) {
+      parsed.push_back(Impl::Parser{patterns[k]}.parse());
+      if (!parsed.back().err_msg.empty()) {
+        err_msg = "pattern " + std::to_string(k) + ": " + parsed.back().err_msg;
+        return;
+      }
+      Impl::simplify(parsed.back());
+    }
+    set = Impl::create_set(parsed);
+  }
+
+  std::vector<size_t> match(std::string_view input) const {
+    return err_msg.empty() ? set.matches(input) : std::vector<size_t>{};
+  }
+
+  size_t size() const { return set.finals.size(); }
+
+  std::string err_msg;
+
+ private:
+  Impl::SetNFA set{Impl::create_err(Impl::NFA::err_state::BAD_PARSE)};
+};
+
+/** A matcher for a pattern known at compile time: `StaticMatcher<"ab*">`.
+ *
+ * The pattern is parsed and compiled into bit-parallel tables during
+ * compilation, so there is no startup cost and no heap use, and `match` is
+ * constexpr. Only the tables the pattern needs are kept, and the loop over
+ * them has a constant trip count the compiler can unroll. A malformed pattern
+ * or one with more than 64 characters and classes, once simplified, does not
+ * compile.
+ */
+template <Impl::FixedString Pattern>
+class StaticMatcher {
+  using mask = Impl::Bitap::mask;
+  static constexpr size_t alphabet_size = Impl::Bitap::alphabet_size;
+  static constexpr size_t chunk_bits = Impl::Bitap::chunk_bits;
+
+  static constexpr Impl::Bitap compiled = Impl::create_bitap([] {
+    Impl::Parser::ParseResult parsed = Impl::Parser{Pattern.str()}.parse();
+    Impl::simplify(parsed);
+    return parsed;
+  }());
+  static_assert(compiled.error != Impl::Bitap::err_state::BAD_PARSE,
+                "invalid regex");
+  static_assert(compiled.error != Impl::Bitap::err_state::TOO_MANY_POSITIONS,
+                "too many characters for a static matcher, at most 64");
+
+ public:
+  static constexpr bool match(std::string_view input) {
+    if (input.empty()) {
+      return nullable;
+    }
+    mask active = first & byte_masks[static_cast<unsigned char>(input[0])];
+    for (size_t i = 1; i < input.size() && active != 0; ++i) {
+      mask next = 0;
+      for (size_t k = 0; k < chunks; ++k) {
+        next |= follow_tables[k][(active >> (k * chunk_bits)) & 0xFFU];
+      }
+      active = next & byte_masks[static_cast<unsigned char>(input[i])];
+    }
+    return (active & last) != 0;
+  }
+
+ private:
+  static constexpr size_t chunks = compiled.chunks;
+  static constexpr std::array<mask, alphabet_size> byte_masks =
+      compiled.byte_masks;
+  static constexpr std::array<std::array<mask, alphabet_size>, chunks>
+      follow_tables = []() {
+        std::array<std::array<mask, alphabet_size>, chunks> result{};
+        std::copy_n(compiled.follow_tables.begin(), chunks, result.begin());
+        return result;
+      }();
+  static constexpr mask first = compiled.first;
+  static constexpr mask last = compiled.last;
+  static constexpr bool nullable = compiled.nullable;
 };
 
 }  // namespace RM
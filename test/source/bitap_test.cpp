@@ -0,0 +1,91 @@
+#include "internal/bitap.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <string>
+
+#include "internal/parser.hpp"
+
+using RM::Impl::Bitap, RM::Impl::create_bitap, RM::Impl::create_positions,
+    RM::Impl::Parser;
+
+namespace {
+Bitap build(const std::string& pattern) {
+  return create_bitap(create_positions(Parser{pattern}.parse()));
+}
+}  // namespace
+
+TEST_CASE("create_bitap") {
+  SECTION("masks") {
+    const Bitap bitap = build("(a|b)*abb");
+    REQUIRE(bitap.error == Bitap::err_state::OK);
+    REQUIRE(bitap.chunks == 1);
+    REQUIRE(bitap.byte_masks['a'] == 0b00101);
+    REQUIRE(bitap.byte_masks['b'] == 0b11010);
+    REQUIRE(bitap.byte_masks['c'] == 0);
+    REQUIRE(bitap.first == 0b00111);
+    REQUIRE(bitap.last == 0b10000);
+    REQUIRE(bitap.follow(0b00001) == 0b00111);
+    REQUIRE(bitap.follow(0b00100) == 0b01000);
+    REQUIRE(bitap.follow(0b01100) == 0b11000);
+    REQUIRE(!bitap.nullable);
+  }
+
+  SECTION("classes") {
+    const Bitap bitap = build("[a-c]+x");
+    REQUIRE(bitap.byte_masks['a'] == 0b01);
+    REQUIRE(bitap.byte_masks['c'] == 0b01);
+    REQUIRE(bitap.byte_masks['d'] == 0);
+    REQUIRE(bitap.byte_masks['x'] == 0b10);
+    REQUIRE(bitap.match("abcx"));
+    REQUIRE(!bitap.match("adx"));
+  }
+
+  SECTION("errors") {
+    REQUIRE(build("(a").error == Bitap::err_state::BAD_PARSE);
+    REQUIRE(build(std::string(65, 'a')).error ==
+            Bitap::err_state::TOO_MANY_POSITIONS);
+    REQUIRE(build(std::string(64, 'a')).error == Bitap::err_state::OK);
+  }
+
+  SECTION("from a parse tree") {
+    const Bitap direct = create_bitap(Parser{"(a|b)*abb"}.parse());
+    REQUIRE(direct.byte_masks == build("(a|b)*abb").byte_masks);
+    REQUIRE(direct.first == 0b00111);
+    REQUIRE(direct.match("babb"));
+    REQUIRE(create_bitap(Parser{"(a"}.parse()).error ==
+            Bitap::err_state::BAD_PARSE);
+    // Counted before the 30001 x 30001 bits of follow sets are built.
+    REQUIRE(create_bitap(Parser{"(a{1000}){30}"}.parse()).error ==
+            Bitap::err_state::TOO_MANY_POSITIONS);
+    REQUIRE(create_bitap(Parser{std::string(64, 'a')}.parse()).error ==
+            Bitap::err_state::OK);
+  }
+}
+
+TEST_CASE("Bitap::match") {
+  SECTION("(a|b)*abb") {
+    const Bitap bitap = build("(a|b)*abb");
+    REQUIRE(bitap.match("abb"));
+    REQUIRE(bitap.match("aababb"));
+    REQUIRE(!bitap.match(""));
+    REQUIRE(!bitap.match("abba"));
+    REQUIRE(!bitap.match("abc"));
+  }
+
+  SECTION("nullable") {
+    const Bitap bitap = build("(ab)?c*");
+    REQUIRE(bitap.match(""));
+    REQUIRE(bitap.match("abccc"));
+    REQUIRE(!bitap.match("ac"));
+  }
+
+  SECTION("positions across chunks") {
+    const std::string pattern =
+        std::string(30, 'x') + "(yz)+" + std::string(30, 'x');
+    const Bitap bitap = build(pattern);
+    REQUIRE(bitap.chunks == 8);
+    const std::string x30(30, 'x');
+    REQUIRE(bitap.match(x30 + "yzyz" + x30));
+    REQUIRE(!bitap.match(x30 + "yzy" + x30));
+  }
+}
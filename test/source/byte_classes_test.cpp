@@ -0,0 +1,67 @@
+#include "internal/byte_classes.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <vector>
+
+using RM::Impl::ByteClasses;
+
+TEST_CASE("ByteClasses") {
+  ByteClasses classes;
+  REQUIRE(classes.size() == 1);
+  REQUIRE(classes.bytes().empty());
+
+  classes.add('b');
+  classes.add('a');
+  classes.add('b');
+  REQUIRE(classes.size() == 3);
+  REQUIRE(classes.of('b') == 1);
+  REQUIRE(classes.of('a') == 2);
+  REQUIRE(classes.of('c') == 0);
+  REQUIRE(classes.of('\xff') == 0);
+  REQUIRE(classes.reads('a'));
+  REQUIRE(!classes.reads('c'));
+  REQUIRE(classes.bytes() == std::vector<char>{'a', 'b'});
+  REQUIRE(classes.representatives() == std::vector<char>{'\0', 'b', 'a'});
+
+  SECTION("merge") {
+    classes.merge({0, 1, 1}, 2);
+    REQUIRE(classes.size() == 2);
+    REQUIRE(classes.of('a') == 1);
+    REQUIRE(classes.of('b') == 1);
+    REQUIRE(classes.of('c') == 0);
+  }
+
+  SECTION("ranges") {
+    classes.add_range('a', 'z');
+    REQUIRE(classes.size() == 4);
+    REQUIRE(classes.of('c') == 3);
+    REQUIRE(classes.of('z') == 3);
+    REQUIRE(classes.of('a') == 2);
+    REQUIRE(classes.reads('z'));
+    REQUIRE(!classes.reads('{'));
+
+    // A range that covers a whole class leaves it as it is.
+    classes.add_range('b', 'b');
+    REQUIRE(classes.size() == 4);
+
+    classes.add_range('x', '\xff');
+    REQUIRE(classes.size() == 6);
+    REQUIRE(classes.of('c') == 3);
+    REQUIRE(classes.of('y') == 4);
+    REQUIRE(classes.of('{') == 5);
+    REQUIRE(classes.of('\xff') == 5);
+    REQUIRE(classes.representatives() ==
+            std::vector<char>{'\0', 'b', 'a', 'c', 'x', '{'});
+  }
+
+  SECTION("every byte") {
+    for (size_t b = 0; b < ByteClasses::alphabet_size; ++b) {
+      classes.add(static_cast<char>(b));
+    }
+    REQUIRE(classes.size() == ByteClasses::alphabet_size);
+    REQUIRE(classes.bytes().size() == ByteClasses::alphabet_size);
+    for (size_t b = 0; b < ByteClasses::alphabet_size; ++b) {
+      REQUIRE(classes.reads(static_cast<char>(b)));
+    }
+  }
+}
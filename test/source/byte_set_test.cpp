@@ -0,0 +1,54 @@
+#include "internal/byte_set.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <utility>
+#include <vector>
+
+using RM::Impl::ByteSet;
+
+TEST_CASE("ByteSet") {
+  ByteSet set;
+  REQUIRE(set.count() == 0);
+
+  set.insert_range('a', 'c');
+  set.insert('x');
+  set.insert('\xff');
+  REQUIRE(set.count() == 5);
+  REQUIRE(set.contains('b'));
+  REQUIRE(set.contains('\xff'));
+  REQUIRE(!set.contains('d'));
+
+  std::vector<std::pair<char, char>> ranges;
+  set.for_each_range(
+      [&](char first, char last) { ranges.emplace_back(first, last); });
+  REQUIRE(ranges == std::vector<std::pair<char, char>>{
+                        {'a', 'c'}, {'x', 'x'}, {'\xff', '\xff'}});
+
+  SECTION("complement") {
+    const ByteSet complement = set.complement();
+    REQUIRE(complement.count() == ByteSet::alphabet_size - 5);
+    REQUIRE(!complement.contains('a'));
+    REQUIRE(complement.contains('\0'));
+    REQUIRE(complement.complement() == set);
+  }
+
+  SECTION("minus and insert_all") {
+    ByteSet other = ByteSet::single('b');
+    other.insert('z');
+    REQUIRE(set.minus(other).count() == 4);
+    REQUIRE(!set.minus(other).contains('b'));
+    set.insert_all(other);
+    REQUIRE(set.count() == 6);
+    REQUIRE(set.contains('z'));
+  }
+
+  SECTION("wildcard") {
+    const ByteSet any = ByteSet::wildcard();
+    REQUIRE(any.count() == ByteSet::alphabet_size - 1);
+    REQUIRE(!any.contains('\n'));
+    REQUIRE(any.contains('\0'));
+    REQUIRE(any.contains('\xff'));
+  }
+
+  static_assert(ByteSet::wildcard().count() == ByteSet::alphabet_size - 1);
+}
@@ -0,0 +1,80 @@
+#include "internal/dfa.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <string>
+
+#include "internal/nfa_creation.hpp"
+
+using RM::Impl::create_dfa, RM::Impl::create_from_str, RM::Impl::DFA,
+    RM::Impl::minimize, RM::Impl::NFA;
+
+namespace {
+NFA build(std::string&& pattern) {
+  std::string err_msg;
+  return create_from_str(std::move(pattern), err_msg);
+}
+}  // namespace
+
+TEST_CASE("create_dfa") {
+  const NFA nfa = build("(a|b)*abb");
+  const DFA dfa = create_dfa(nfa, 100);
+  REQUIRE(dfa.error == DFA::err_state::OK);
+  // Every byte other than 'a' and 'b' is in class 0.
+  REQUIRE(dfa.classes.size() == 3);
+  REQUIRE(dfa.table.size() == dfa.size * dfa.classes.size());
+  REQUIRE(dfa.accepting[dfa.dead_state] == 0);
+  REQUIRE(dfa.next(dfa.dead_state, 'a') == dfa.dead_state);
+  REQUIRE(dfa.next(dfa.initial_state, 'c') == dfa.dead_state);
+  REQUIRE(dfa.match("abb"));
+  REQUIRE(dfa.match("babb"));
+  REQUIRE(!dfa.match("ab"));
+  REQUIRE(!dfa.match("abbc"));
+
+  REQUIRE(create_dfa(nfa, 2).error == DFA::err_state::TOO_MANY_STATES);
+}
+
+TEST_CASE("minimize") {
+  SECTION("(a|b)*abb") {
+    // The textbook minimal DFA has 4 states, plus the dead state here.
+    const DFA dfa = minimize(create_dfa(build("(a|b)*abb"), 100));
+    REQUIRE(dfa.error == DFA::err_state::OK);
+    REQUIRE(dfa.size == 5);
+    REQUIRE(dfa.match("abb"));
+    REQUIRE(dfa.match("aababb"));
+    REQUIRE(!dfa.match(""));
+    REQUIRE(!dfa.match("abba"));
+  }
+
+  SECTION("equivalent branches merge") {
+    const DFA dfa = minimize(create_dfa(build("(ab|ab|ab)c*"), 100));
+    // Start, after "a", after "ab" (accepting, loops on "c"), dead.
+    REQUIRE(dfa.size == 4);
+    REQUIRE(dfa.match("ab"));
+    REQUIRE(dfa.match("abccc"));
+    REQUIRE(!dfa.match("abcb"));
+  }
+
+  SECTION("states that cannot accept merge into the dead state") {
+    const DFA dfa = minimize(create_dfa(build("a"), 100));
+    REQUIRE(dfa.size == 3);
+    REQUIRE(dfa.next(dfa.next(dfa.initial_state, 'a'), 'a') ==
+            dfa.dead_state);
+  }
+}
+
+TEST_CASE("minimize merges byte classes") {
+  const DFA dfa = minimize(create_dfa(build("(a|b)*c"), 100));
+  // a and b lead to the same states everywhere once minimized.
+  REQUIRE(dfa.classes.size() == 3);
+  REQUIRE(dfa.classes.of('a') == dfa.classes.of('b'));
+  REQUIRE(dfa.classes.of('a') != dfa.classes.of('c'));
+  REQUIRE(dfa.classes.of('a') != dfa.classes.of('d'));
+  REQUIRE(dfa.table.size() == dfa.size * 3);
+  REQUIRE(dfa.match("abbac"));
+  REQUIRE(dfa.match("c"));
+  REQUIRE(!dfa.match("abd"));
+  REQUIRE(!dfa.match("cc"));
+
+  const DFA distinct = minimize(create_dfa(build("abc"), 100));
+  REQUIRE(distinct.classes.size() == 4);
+}
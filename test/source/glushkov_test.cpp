@@ -0,0 +1,134 @@
+#include "internal/glushkov.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <vector>
+
+#include "internal/parser.hpp"
+
+using RM::Impl::ByteSet, RM::Impl::count_positions, RM::Impl::create_glushkov,
+    RM::Impl::create_positions, RM::Impl::NFA, RM::Impl::Parser,
+    RM::Impl::StateBitset;
+
+namespace {
+std::vector<size_t> elements(const StateBitset& set) {
+  std::vector<size_t> result;
+  set.for_each([&](size_t i) { result.push_back(i); });
+  return result;
+}
+}  // namespace
+
+TEST_CASE("create_positions") {
+  SECTION("(a|b)*abb") {
+    const auto positions = create_positions(Parser{"(a|b)*abb"}.parse());
+    REQUIRE(positions.valid);
+    REQUIRE(positions.position_count() == 5);
+    const ByteSet a = ByteSet::single('a');
+    const ByteSet b = ByteSet::single('b');
+    REQUIRE(positions.labels == std::vector<ByteSet>{{}, a, b, a, b, b});
+    REQUIRE(!positions.nullable);
+    REQUIRE(elements(positions.first) == std::vector<size_t>{1, 2, 3});
+    REQUIRE(elements(positions.last) == std::vector<size_t>{5});
+    REQUIRE(elements(positions.follow[1]) == std::vector<size_t>{1, 2, 3});
+    REQUIRE(elements(positions.follow[2]) == std::vector<size_t>{1, 2, 3});
+    REQUIRE(elements(positions.follow[3]) == std::vector<size_t>{4});
+    REQUIRE(elements(positions.follow[4]) == std::vector<size_t>{5});
+    REQUIRE(elements(positions.follow[5]).empty());
+  }
+
+  SECTION("(ab)?c*") {
+    const auto positions = create_positions(Parser{"(ab)?c*"}.parse());
+    REQUIRE(positions.nullable);
+    REQUIRE(elements(positions.first) == std::vector<size_t>{1, 3});
+    REQUIRE(elements(positions.last) == std::vector<size_t>{2, 3});
+    REQUIRE(elements(positions.follow[2]) == std::vector<size_t>{3});
+    REQUIRE(elements(positions.follow[3]) == std::vector<size_t>{3});
+  }
+
+  SECTION("[a-c]x.") {
+    const auto positions = create_positions(Parser{"[a-c]x."}.parse());
+    REQUIRE(positions.position_count() == 3);
+    REQUIRE(positions.labels[1].count() == 3);
+    REQUIRE(positions.labels[2] == ByteSet::single('x'));
+    REQUIRE(positions.labels[3] == ByteSet::wildcard());
+  }
+
+  SECTION("error") {
+    REQUIRE(!create_positions(Parser{"(a"}.parse()).valid);
+  }
+}
+
+TEST_CASE("create_glushkov") {
+  SECTION("no epsilon transitions") {
+    const NFA nfa = create_glushkov(Parser{"(a|b)*abb"}.parse());
+    REQUIRE(nfa.error == NFA::err_state::OK);
+    REQUIRE(nfa.size == 7);
+    REQUIRE(nfa.final_state == 6);
+    for (const auto& targets : nfa.eps_transitions) {
+      REQUIRE(targets.empty());
+    }
+    REQUIRE(nfa.match_bitset("abb"));
+    REQUIRE(nfa.match_bitset("babb"));
+    REQUIRE(!nfa.match_bitset("ab"));
+  }
+
+  SECTION("nullable") {
+    const NFA nfa = create_glushkov(Parser{"(ab)?c*"}.parse());
+    REQUIRE(nfa.eps_transitions[0] ==
+            std::vector<NFA::state>{nfa.final_state});
+    REQUIRE(nfa.match_bitset(""));
+    REQUIRE(nfa.match_bitset("abc"));
+    REQUIRE(nfa.match_bitset("cc"));
+    REQUIRE(!nfa.match_bitset("a"));
+  }
+
+  SECTION("overlapping classes") {
+    const NFA nfa = create_glushkov(Parser{"[a-c]|[b-d]"}.parse());
+    REQUIRE(nfa.size == 4);
+    // The edges into the final state read each byte once: "[a-c]" and "d".
+    REQUIRE(nfa.transitions[0].size() == 4);
+    REQUIRE(nfa.match_bitset("b"));
+    REQUIRE(nfa.match_bitset("d"));
+    REQUIRE(!nfa.match_bitset("ab"));
+  }
+
+  SECTION("bounded repetition stays linear") {
+    const NFA nfa = create_glushkov(Parser{"a{1,1000}"}.parse());
+    REQUIRE(nfa.size == 1002);
+    size_t edges = 0;
+    for (const auto& targets : nfa.transitions) {
+      edges += targets.size();
+    }
+    // An edge to the next position and one to the final state per position.
+    REQUIRE(edges == 2000);
+  }
+
+  SECTION("error") {
+    REQUIRE(create_glushkov(Parser{"(a"}.parse()).error ==
+            NFA::err_state::BAD_PARSE);
+  }
+}
+
+TEST_CASE("count_positions") {
+  REQUIRE(count_positions(Parser{"(a|b)*abb"}.parse()) == 5);
+  REQUIRE(count_positions(Parser{"[a-z]+x?"}.parse()) == 2);
+  REQUIRE(count_positions(Parser{"(a{1000}){30}"}.parse()) == 30000);
+  REQUIRE(count_positions(Parser{"(a"}.parse()) == 0);
+}
+
+TEST_CASE("create_glushkov size limits") {
+  // 20000 positions take 400M follow set bits.
+  const auto too_wide = create_positions(Parser{"(a{1000}){20}"}.parse());
+  REQUIRE(!too_wide.valid);
+  REQUIRE(too_wide.too_large);
+  REQUIRE(create_glushkov(Parser{"(a{1000}){20}"}.parse()).error ==
+          NFA::err_state::TOO_LARGE);
+
+  // 3000 positions, each followed by all the ones after it.
+  const auto dense = create_positions(Parser{"((a?){1000}){3}"}.parse());
+  REQUIRE(dense.valid);
+  REQUIRE(create_glushkov(Parser{"((a?){1000}){3}"}.parse()).error ==
+          NFA::err_state::TOO_LARGE);
+
+  REQUIRE(create_glushkov(Parser{"(a?){1000}"}.parse()).error ==
+          NFA::err_state::OK);
+}
@@ -0,0 +1,59 @@
+#include "internal/lazy_dfa.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <string>
+
+#include "internal/nfa_creation.hpp"
+
+using RM::Impl::create_from_str, RM::Impl::LazyDFA, RM::Impl::NFA;
+
+namespace {
+NFA build(std::string&& pattern) {
+  std::string err_msg;
+  return create_from_str(std::move(pattern), err_msg);
+}
+}  // namespace
+
+TEST_CASE("LazyDFA::match") {
+  const NFA nfa = build("(a|b)*abb");
+  LazyDFA dfa;
+
+  SECTION("results") {
+    REQUIRE(dfa.match(nfa, "abb"));
+    REQUIRE(dfa.match(nfa, "aababb"));
+    REQUIRE(!dfa.match(nfa, ""));
+    REQUIRE(!dfa.match(nfa, "abba"));
+    REQUIRE(!dfa.match(nfa, "abc"));
+  }
+
+  SECTION("states are reused between matches") {
+    REQUIRE(dfa.match(nfa, "babababb"));
+    const size_t states = dfa.state_count();
+    REQUIRE(dfa.match(nfa, "babababb"));
+    REQUIRE(dfa.state_count() == states);
+    REQUIRE(dfa.clear_count() == 0);
+  }
+}
+
+TEST_CASE("LazyDFA cache limit") {
+  const NFA nfa = build("(a|b)*a(a|b)(a|b)(a|b)");
+  const std::string input = "abbbabaabbbaaabababbabbb";
+  REQUIRE(nfa.match(input));
+
+  SECTION("clear") {
+    LazyDFA unbounded;
+    REQUIRE(unbounded.match(nfa, input));
+    LazyDFA dfa{unbounded.memory_used() / 2, LazyDFA::overflow::CLEAR};
+    REQUIRE(dfa.match(nfa, input));
+    REQUIRE(dfa.clear_count() > 0);
+    REQUIRE(dfa.memory_used() <= unbounded.memory_used() / 2);
+    REQUIRE(!dfa.match(nfa, input + "bbbb"));
+  }
+
+  SECTION("fallback") {
+    LazyDFA dfa{1, LazyDFA::overflow::FALLBACK};
+    REQUIRE(dfa.match(nfa, input));
+    REQUIRE(!dfa.match(nfa, input + "bbbb"));
+    REQUIRE(dfa.clear_count() == 0);
+  }
+}
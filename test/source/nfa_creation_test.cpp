@@ -1,13 +1,16 @@
 #include "internal/nfa_creation.hpp"
 
+#include <algorithm>
 #include <catch2/catch_all.hpp>
+#include <tuple>
 
 #include "internal/nfa.hpp"
 
-using RM::Impl::Parser, RM::Impl::NFA, RM::Impl::create_basic,
-    RM::Impl::create_concat, RM::Impl::create_from_parse,
-    RM::Impl::create_kleene_star, RM::Impl::create_one_or_more,
-    RM::Impl::create_optional, RM::Impl::create_basic, RM::Impl::create_or;
+using RM::Impl::Parser, RM::Impl::NFA, RM::Impl::ByteSet,
+    RM::Impl::create_basic, RM::Impl::create_class, RM::Impl::create_concat,
+    RM::Impl::create_from_parse, RM::Impl::create_kleene_star,
+    RM::Impl::create_one_or_more, RM::Impl::create_optional,
+    RM::Impl::create_basic, RM::Impl::create_or;
 
 TEST_CASE("create_err") {
   NFA result = create_err(NFA::err_state::BAD_PARSE);
@@ -21,11 +24,25 @@ TEST_CASE("create_basic") {
   REQUIRE(result.size == 2);
   REQUIRE(result.initial_state == 0);
   REQUIRE(result.final_state == 1);
-  REQUIRE(result.inputs == std::unordered_set<char>{'t'});
-  REQUIRE(result.transitions == NFA::trans_vec{
-                                    {'\0', 't'},
-                                    {'\0', '\0'},
-                                });
+  REQUIRE(result.byte_classes.bytes() == std::vector<char>{'t'});
+  REQUIRE(result.transitions == NFA::trans_vec{{{1, 't'}}, {}});
+  REQUIRE(result.eps_transitions == NFA::eps_vec{{}, {}});
+}
+
+TEST_CASE("create_class") {
+  ByteSet bytes;
+  bytes.insert_range('a', 'c');
+  bytes.insert('x');
+  NFA result = create_class(bytes);
+  REQUIRE(result.error == NFA::err_state::OK);
+  REQUIRE(result.size == 2);
+  REQUIRE(result.transitions ==
+          NFA::trans_vec{{{.to = 1, .input = 'a', .last = 'c'}, {1, 'x'}}, {}});
+  REQUIRE(result.byte_classes.size() == 3);
+  REQUIRE(result.byte_classes.bytes() ==
+          std::vector<char>{'a', 'b', 'c', 'x'});
+  REQUIRE(result.match("b"));
+  REQUIRE(!result.match("d"));
 }
 
 TEST_CASE("create_concat") {
@@ -34,12 +51,9 @@ TEST_CASE("create_concat") {
   REQUIRE(result.size == 3);
   REQUIRE(result.initial_state == 0);
   REQUIRE(result.final_state == 2);
-  REQUIRE(result.inputs == std::unordered_set<char>{'a', 'b'});
-  REQUIRE(result.transitions == NFA::trans_vec{
-                                    {'\0', 'a', '\0'},
-                                    {'\0', '\0', 'b'},
-                                    {'\0', '\0', '\0'},
-                                });
+  REQUIRE(result.byte_classes.bytes() == std::vector<char>{'a', 'b'});
+  REQUIRE(result.transitions == NFA::trans_vec{{{1, 'a'}}, {{2, 'b'}}, {}});
+  REQUIRE(result.eps_transitions == NFA::eps_vec{{}, {}, {}});
 }
 
 TEST_CASE("create_kleene_star") {
@@ -48,13 +62,9 @@ TEST_CASE("create_kleene_star") {
   REQUIRE(result.size == 4);
   REQUIRE(result.initial_state == 0);
   REQUIRE(result.final_state == 3);
-  REQUIRE(result.inputs == std::unordered_set<char>{'x'});
-  REQUIRE(result.transitions == NFA::trans_vec{
-                                    {'\0', -1, '\0', -1},
-                                    {'\0', '\0', 'x', '\0'},
-                                    {'\0', -1, '\0', -1},
-                                    {'\0', '\0', '\0', '\0'},
-                                });
+  REQUIRE(result.byte_classes.bytes() == std::vector<char>{'x'});
+  REQUIRE(result.transitions == NFA::trans_vec{{}, {{2, 'x'}}, {}, {}});
+  REQUIRE(result.eps_transitions == NFA::eps_vec{{1, 3}, {}, {1, 3}, {}});
 }
 
 TEST_CASE("create_one_or_more") {
@@ -63,12 +73,9 @@ TEST_CASE("create_one_or_more") {
   REQUIRE(result.size == 3);
   REQUIRE(result.initial_state == 0);
   REQUIRE(result.final_state == 2);
-  REQUIRE(result.inputs == std::unordered_set<char>{'a'});
-  REQUIRE(result.transitions == NFA::trans_vec{
-                                    {'\0', 'a', '\0'},
-                                    {'\0', '\0', -1},
-                                    {-1, '\0', '\0'},
-                                });
+  REQUIRE(result.byte_classes.bytes() == std::vector<char>{'a'});
+  REQUIRE(result.transitions == NFA::trans_vec{{{1, 'a'}}, {}, {}});
+  REQUIRE(result.eps_transitions == NFA::eps_vec{{}, {2, 0}, {}});
 }
 
 TEST_CASE("create_optional") {
@@ -77,13 +84,9 @@ TEST_CASE("create_optional") {
   REQUIRE(result.size == 4);
   REQUIRE(result.initial_state == 0);
   REQUIRE(result.final_state == 3);
-  REQUIRE(result.inputs == std::unordered_set<char>{'a'});
-  REQUIRE(result.transitions == NFA::trans_vec{
-                                    {'\0', -1, '\0', -1},
-                                    {'\0', '\0', 'a', '\0'},
-                                    {'\0', '\0', '\0', -1},
-                                    {'\0', '\0', '\0', '\0'},
-                                });
+  REQUIRE(result.byte_classes.bytes() == std::vector<char>{'a'});
+  REQUIRE(result.transitions == NFA::trans_vec{{}, {{2, 'a'}}, {}, {}});
+  REQUIRE(result.eps_transitions == NFA::eps_vec{{1, 3}, {}, {3}, {}});
 }
 
 TEST_CASE("create_or") {
@@ -92,15 +95,17 @@ TEST_CASE("create_or") {
   REQUIRE(result.size == 6);
   REQUIRE(result.initial_state == 0);
   REQUIRE(result.final_state == 5);
-  REQUIRE(result.inputs == std::unordered_set<char>{'a', 'b'});
+  REQUIRE(result.byte_classes.bytes() == std::vector<char>{'a', 'b'});
   REQUIRE(result.transitions == NFA::trans_vec{
-                                    {'\0', -1, '\0', -1, '\0', '\0'},
-                                    {'\0', '\0', 'a', '\0', '\0', '\0'},
-                                    {'\0', '\0', '\0', '\0', '\0', -1},
-                                    {'\0', '\0', '\0', '\0', 'b', '\0'},
-                                    {'\0', '\0', '\0', '\0', '\0', -1},
-                                    {'\0', '\0', '\0', '\0', '\0', '\0'},
+                                    {},
+                                    {{2, 'a'}},
+                                    {},
+                                    {{4, 'b'}},
+                                    {},
+                                    {},
                                 });
+  REQUIRE(result.eps_transitions ==
+          NFA::eps_vec{{1, 3}, {}, {5}, {}, {5}, {}});
 }
 
 TEST_CASE("create_from_parse") {
@@ -109,13 +114,75 @@ TEST_CASE("create_from_parse") {
   REQUIRE(result.size == 6);
   REQUIRE(result.initial_state == 0);
   REQUIRE(result.final_state == 5);
-  REQUIRE(result.inputs == std::unordered_set<char>{'a', 'b'});
+  REQUIRE(result.byte_classes.bytes() == std::vector<char>{'a', 'b'});
   REQUIRE(result.transitions == NFA::trans_vec{
-                                    {'\0', -1, '\0', -1, '\0', '\0'},
-                                    {'\0', '\0', 'a', '\0', '\0', '\0'},
-                                    {'\0', '\0', '\0', '\0', '\0', -1},
-                                    {'\0', '\0', '\0', '\0', 'b', '\0'},
-                                    {'\0', '\0', '\0', '\0', '\0', -1},
-                                    {'\0', '\0', '\0', '\0', '\0', '\0'},
+                                    {},
+                                    {{2, 'a'}},
+                                    {},
+                                    {{4, 'b'}},
+                                    {},
+                                    {},
                                 });
+  REQUIRE(result.eps_transitions ==
+          NFA::eps_vec{{1, 3}, {}, {5}, {}, {5}, {}});
+}
+
+TEST_CASE("create_from_parse matches the composed construction") {
+  auto built = create_from_parse(Parser{"(a|b)*a(cd)+e?"}.parse());
+  NFA composed = create_concat(
+      create_concat(
+          create_kleene_star(create_or(create_basic('a'), create_basic('b'))),
+          create_basic('a')),
+      create_concat(create_one_or_more(
+                        create_concat(create_basic('c'), create_basic('d'))),
+                    create_optional(create_basic('e'))));
+  REQUIRE(built.error == NFA::err_state::OK);
+  REQUIRE(built.size == composed.size);
+  REQUIRE(built.initial_state == composed.initial_state);
+  REQUIRE(built.final_state == composed.final_state);
+  REQUIRE(built.byte_classes.bytes() == composed.byte_classes.bytes());
+
+  // Edges leaving a shared state may be listed in a different order.
+  const auto sorted = [](auto rows) {
+    for (auto& row : rows) {
+      std::sort(row.begin(), row.end(), [](const auto& x, const auto& y) {
+        return std::tie(x.to, x.input) < std::tie(y.to, y.input);
+      });
+    }
+    return rows;
+  };
+  REQUIRE(sorted(built.transitions) == sorted(composed.transitions));
+  for (NFA::state s = 0; s < built.size; ++s) {
+    auto x = built.eps_transitions[s];
+    auto y = composed.eps_transitions[s];
+    std::sort(x.begin(), x.end());
+    std::sort(y.begin(), y.end());
+    REQUIRE(x == y);
+  }
+}
+
+TEST_CASE("create_from_parse with character classes") {
+  std::string chain = "(";
+  for (char c = 'a'; c <= 'z'; ++c) {
+    chain += std::string(1, c) + "|";
+  }
+  for (char c = '0'; c <= '9'; ++c) {
+    chain += std::string(1, c) + (c == '9' ? ")+" : "|");
+  }
+  const NFA alternation = create_from_parse(Parser{chain}.parse());
+  const NFA cls = create_from_parse(Parser{"[a-z0-9]+"}.parse());
+  REQUIRE(cls.error == NFA::err_state::OK);
+  REQUIRE(cls.size == 3);
+  REQUIRE(alternation.size == 2 * 36 + 2 * 35 + 1);
+  REQUIRE(cls.byte_classes.size() == 3);
+  for (const std::string input : {"", "a", "z09", "a-b", "A"}) {
+    INFO(input);
+    REQUIRE(cls.match(input) == alternation.match(input));
+  }
+
+  const NFA negated = create_from_parse(Parser{"[^a]."}.parse());
+  REQUIRE(negated.match("ba"));
+  REQUIRE(negated.match("\xff\xff"));
+  REQUIRE(!negated.match("ab"));
+  REQUIRE(!negated.match("b\n"));
 }
@@ -14,8 +14,9 @@ TEST_CASE("NFA::nfa") {
     REQUIRE(nfa.size == 2);
     REQUIRE(nfa.initial_state == 0);
     REQUIRE(nfa.final_state == 1);
-    REQUIRE(nfa.inputs.empty());
-    REQUIRE(nfa.transitions == NFA::trans_vec{{'\0', '\0'}, {'\0', '\0'}});
+    REQUIRE(nfa.byte_classes.bytes().empty());
+    REQUIRE(nfa.transitions == NFA::trans_vec{{}, {}});
+    REQUIRE(nfa.eps_transitions == NFA::eps_vec{{}, {}});
     REQUIRE(nfa.error == NFA::err_state::OK);
   }
 
@@ -34,23 +35,30 @@ TEST_CASE("NFA::add_transition") {
   SECTION("Basic case") {
     NFA nfa{3, {0, 2}};
 
-    REQUIRE(nfa.transitions == NFA::trans_vec{
-                                   {'\0', '\0', '\0'},
-                                   {'\0', '\0', '\0'},
-                                   {'\0', '\0', '\0'},
-                               });
+    REQUIRE(nfa.transitions == NFA::trans_vec{{}, {}, {}});
     nfa.add_transition({0, 1}, 'A');
     nfa.add_transition({1, 2}, 'B');
     nfa.add_transition({2, 0}, 'C');
     REQUIRE(nfa.transitions == NFA::trans_vec{
-                                   {'\0', 'A', '\0'},
-                                   {'\0', '\0', 'B'},
-                                   {'C', '\0', '\0'},
+                                   {{1, 'A'}},
+                                   {{2, 'B'}},
+                                   {{0, 'C'}},
                                });
-    REQUIRE(nfa.inputs == std::unordered_set<char>{'A', 'B', 'C'});
+    REQUIRE(nfa.eps_transitions == NFA::eps_vec{{}, {}, {}});
+    REQUIRE(nfa.byte_classes.bytes() == std::vector<char>{'A', 'B', 'C'});
     REQUIRE(nfa.error == NFA::err_state::OK);
   }
 
+  SECTION("Epsilon transitions") {
+    NFA nfa{3, {0, 2}};
+    nfa.add_transition({0, 1}, -1);
+    nfa.add_transition({0, 2}, -1);
+    nfa.add_transition({1, 2}, 'a');
+    REQUIRE(nfa.transitions == NFA::trans_vec{{}, {{2, 'a'}}, {}});
+    REQUIRE(nfa.eps_transitions == NFA::eps_vec{{1, 2}, {}, {}});
+    REQUIRE(nfa.byte_classes.bytes() == std::vector<char>{'a'});
+  }
+
   SECTION("Bad NFA `from` state") {
     NFA nfa{2, {0, 1}};
     nfa.add_transition({2, 1}, 'a');
@@ -71,11 +79,11 @@ TEST_CASE("fill_states_from") {
   nfa2.add_transition({1, 0}, 'b');
   nfa1.fill_states_from(nfa2);
   REQUIRE(nfa1.transitions == NFA::trans_vec{
-                                  {'\0', 'a', '\0'},
-                                  {'b', '\0', '\0'},
-                                  {'\0', '\0', '\0'},
+                                  {{1, 'a'}},
+                                  {{0, 'b'}},
+                                  {},
                               });
-  REQUIRE(nfa1.inputs == std::unordered_set<char>{'a', 'b'});
+  REQUIRE(nfa1.byte_classes.bytes() == std::vector<char>{'a', 'b'});
 }
 
 TEST_CASE("shift_states") {
@@ -87,10 +95,10 @@ TEST_CASE("shift_states") {
   REQUIRE(nfa.initial_state == 2);
   REQUIRE(nfa.final_state == 3);
   REQUIRE(nfa.transitions == NFA::trans_vec{
-                                 {'\0', '\0', '\0', '\0'},
-                                 {'\0', '\0', '\0', '\0'},
-                                 {'\0', '\0', '\0', 'a'},
-                                 {'\0', '\0', 'b', '\0'},
+                                 {},
+                                 {},
+                                 {{3, 'a'}},
+                                 {{2, 'b'}},
                              });
 }
 
@@ -98,12 +106,8 @@ TEST_CASE("push_empty_state") {
   NFA nfa{3, {0, 2}};
   nfa.push_empty_state();
   REQUIRE(nfa.size == 4);
-  REQUIRE(nfa.transitions == NFA::trans_vec{
-                                 {'\0', '\0', '\0', '\0'},
-                                 {'\0', '\0', '\0', '\0'},
-                                 {'\0', '\0', '\0', '\0'},
-                                 {'\0', '\0', '\0', '\0'},
-                             });
+  REQUIRE(nfa.transitions == NFA::trans_vec{{}, {}, {}, {}});
+  REQUIRE(nfa.eps_transitions == NFA::eps_vec{{}, {}, {}, {}});
 }
 
 TEST_CASE("NFA::get_reachable_states") {
@@ -145,3 +149,59 @@ TEST_CASE("NFA::eps_closure") {
     REQUIRE(nfa.eps_closure({1, 7}) == set{1, 2, 4, 7});
   }
 }
+
+TEST_CASE("NFA::compute_closures") {
+  using set = std::unordered_set<NFA::state>;
+  NFA a_or_b_star =
+      create_kleene_star(create_or(create_basic('a'), create_basic('b')));
+  NFA nfa = create_concat(std::move(a_or_b_star), create_basic('a'));
+  REQUIRE(!nfa.has_closures());
+
+  nfa.compute_closures();
+  REQUIRE(nfa.has_closures());
+  REQUIRE(nfa.closure_offsets.size() == nfa.size + 1);
+  const auto closure = nfa.closure_of(3);
+  REQUIRE(set(closure.begin(), closure.end()) == set{1, 2, 3, 4, 6, 7});
+  REQUIRE(nfa.eps_closure({0}) == set{0, 1, 2, 4, 7});
+  REQUIRE(nfa.eps_closure({1, 7}) == set{1, 2, 4, 7});
+  REQUIRE(nfa.eps_closure({8}) == set{8});
+  REQUIRE(nfa.match("aba"));
+  REQUIRE(nfa.match_bitset("aba"));
+  REQUIRE(!nfa.match_bitset("ab"));
+
+  nfa.add_transition({8, 0}, -1);
+  REQUIRE(!nfa.has_closures());
+}
+
+TEST_CASE("NFA::compute_closures over budget") {
+  // Every state of an epsilon chain reaches all the states after it.
+  const size_t n = 3000;
+  NFA chain{n + 1, {0, n}};
+  for (NFA::state s = 0; s + 1 < n; ++s) {
+    chain.add_transition({s, s + 1}, -1);
+  }
+  chain.add_transition({n - 1, n}, 'a');
+  REQUIRE(n * (n + 1) / 2 > NFA::closure_budget);
+
+  chain.compute_closures();
+  REQUIRE(!chain.has_closures());
+  REQUIRE(chain.closures.empty());
+  REQUIRE(chain.match("a"));
+  REQUIRE(chain.match_bitset("a"));
+  REQUIRE(!chain.match_bitset("aa"));
+}
+
+TEST_CASE("NFA::match_bitset") {
+  NFA a_or_b_star =
+      create_kleene_star(create_or(create_basic('a'), create_basic('b')));
+  const NFA nfa = create_concat(std::move(a_or_b_star), create_basic('a'));
+
+  for (const std::string input : {"a", "aa", "ba", "abba", "bbbbba"}) {
+    REQUIRE(nfa.match(input));
+    REQUIRE(nfa.match_bitset(input));
+  }
+  for (const std::string input : {"", "b", "ab", "abc", "c"}) {
+    REQUIRE(!nfa.match(input));
+    REQUIRE(!nfa.match_bitset(input));
+  }
+}
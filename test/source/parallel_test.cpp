@@ -0,0 +1,119 @@
+#include "internal/parallel.hpp"
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "internal/glushkov.hpp"
+#include "internal/nfa_creation.hpp"
+#include "internal/parser.hpp"
+
+using RM::Impl::Bitap, RM::Impl::create_bitap, RM::Impl::create_dfa,
+    RM::Impl::create_from_parse, RM::Impl::create_positions, RM::Impl::DFA,
+    RM::Impl::for_each_index, RM::Impl::match_parallel, RM::Impl::minimize,
+    RM::Impl::Parser;
+
+namespace {
+DFA build_dfa(const std::string& pattern) {
+  return minimize(create_dfa(create_from_parse(Parser{pattern}.parse()), 1000));
+}
+
+Bitap build_bitap(const std::string& pattern) {
+  return create_bitap(create_positions(Parser{pattern}.parse()));
+}
+
+std::string random_input(size_t size, const std::string& alphabet,
+                         unsigned seed) {
+  std::mt19937 gen{seed};
+  std::uniform_int_distribution<size_t> pick{0, alphabet.size() - 1};
+  std::string result(size, ' ');
+  for (char& c : result) {
+    c = alphabet[pick(gen)];
+  }
+  return result;
+}
+}  // namespace
+
+TEST_CASE("match_parallel") {
+  const std::vector<std::string> patterns{"(a|b)*abb", "(a|b)*a(a|b)(a|b)",
+                                          "((ab)*b)*a+", "(a|b|c)*"};
+  for (const std::string& pattern : patterns) {
+    const DFA dfa = build_dfa(pattern);
+    const Bitap bitap = build_bitap(pattern);
+    for (unsigned seed = 0; seed < 10; ++seed) {
+      std::string input = random_input(5000, "ab", seed);
+      if (seed % 2 == 0) {
+        input += "abb";
+      }
+      const bool expected = dfa.match(input);
+      REQUIRE(bitap.match(input) == expected);
+      for (const size_t threads : {size_t{1}, size_t{2}, size_t{7}}) {
+        INFO(pattern << " / " << seed << " / " << threads);
+        REQUIRE(match_parallel(dfa, input, threads, 100) == expected);
+        REQUIRE(match_parallel(bitap, input, threads, 100) == expected);
+      }
+    }
+  }
+
+  SECTION("a chunk that rejects everything") {
+    const DFA dfa = build_dfa("(a|b)*");
+    const Bitap bitap = build_bitap("(a|b)*");
+    const std::string input = std::string(1000, 'a') + "c" +
+                              std::string(1000, 'b');
+    REQUIRE(!match_parallel(dfa, input, 4, 100));
+    REQUIRE(!match_parallel(bitap, input, 4, 100));
+    REQUIRE(match_parallel(dfa, std::string(2000, 'a'), 4, 100));
+  }
+
+  SECTION("short input") {
+    const Bitap bitap = build_bitap("a*");
+    REQUIRE(match_parallel(bitap, "", 4, 100));
+    REQUIRE(match_parallel(build_dfa("a*"), "", 4, 100));
+    REQUIRE(!match_parallel(build_dfa("a"), "", 4, 100));
+  }
+
+  SECTION("tiny chunks") {
+    // Rounding the chunk size up used to put the last chunks past the end.
+    const Bitap bitap = build_bitap("a*");
+    const DFA dfa = build_dfa("a*");
+    for (const size_t min_chunk : {size_t{0}, size_t{1}, size_t{2}}) {
+      for (const size_t size : {size_t{1}, size_t{5}, size_t{7}}) {
+        INFO(min_chunk << " / " << size);
+        REQUIRE(match_parallel(bitap, std::string(size, 'a'), 4, min_chunk));
+        REQUIRE(match_parallel(dfa, std::string(size, 'a'), 4, min_chunk));
+        REQUIRE(!match_parallel(dfa, std::string(size, 'a') + "b", 4,
+                                min_chunk));
+      }
+    }
+  }
+}
+
+TEST_CASE("for_each_index") {
+  for (const size_t n : {size_t{0}, size_t{1}, size_t{100}, size_t{5000}}) {
+    for (const size_t threads : {size_t{1}, size_t{3}, size_t{8}}) {
+      INFO(n << " / " << threads);
+      std::vector<std::atomic<int>> visits(n);
+      std::atomic<int> workers{0};
+      for_each_index(
+          n, threads,
+          [&]() {
+            ++workers;
+            // Uneven work, so that threads run out early and steal.
+            return [&](size_t i) {
+              if (i < n / 4) {
+                std::this_thread::yield();
+              }
+              ++visits[i];
+            };
+          },
+          16);
+      for (const std::atomic<int>& v : visits) {
+        REQUIRE(v == 1);
+      }
+      REQUIRE(workers <= static_cast<int>(threads));
+    }
+  }
+}
@@ -6,6 +6,7 @@
 #include <catch2/catch_all.hpp>
 #include <string>
 
+using RM::Impl::ByteSet;
 using RM::Impl::ParseNode;
 using RM::Impl::Parser;
 
@@ -152,6 +153,89 @@ TEST_CASE("Parser::parse") {
     REQUIRE_NODE_ERR("()(())", "empty () expression");
     REQUIRE_NODE_ERR("a(bcd())", "empty () expression");
   }
+
+  SECTION("character classes") {
+    auto parsed = Parser{"[a-c]*.\\."}.parse();
+    REQUIRE(parsed.err_msg.empty());
+    REQUIRE(parsed.first_node == 5);
+    auto result = parsed.nodes;
+    REQUIRE(result.size() == 6);
+    REQUIRE_NODE_EQ(result[0], -1, -1, ParseNode::NodeType::CLASS, '\0');
+    REQUIRE(result[0].set == 0);
+    REQUIRE_NODE_EQ(result[1], 0, -1, ParseNode::NodeType::KLEENE_STAR, '\0');
+    REQUIRE_NODE_EQ(result[2], -1, -1, ParseNode::NodeType::CLASS, '\0');
+    REQUIRE(result[2].set == 1);
+    REQUIRE_NODE_EQ(result[3], -1, -1, ParseNode::NodeType::CHAR, '.');
+    REQUIRE_NODE_EQ(result[4], 2, 3, ParseNode::NodeType::CONCAT, '\0');
+    REQUIRE_NODE_EQ(result[5], 1, 4, ParseNode::NodeType::CONCAT, '\0');
+    REQUIRE(parsed.sets.size() == 2);
+    REQUIRE(parsed.sets[0].count() == 3);
+    REQUIRE(parsed.sets[1] == ByteSet::wildcard());
+  }
+
+  SECTION("exact repetition") {
+    auto parsed = Parser{"ab{3}"}.parse();
+    REQUIRE(parsed.err_msg.empty());
+    REQUIRE(parsed.first_node == 6);
+    auto result = parsed.nodes;
+    REQUIRE(result.size() == 7);
+    REQUIRE_NODE_EQ(result[0], -1, -1, ParseNode::NodeType::CHAR, 'a');
+    REQUIRE_NODE_EQ(result[1], -1, -1, ParseNode::NodeType::CHAR, 'b');
+    REQUIRE_NODE_EQ(result[2], -1, -1, ParseNode::NodeType::CHAR, 'b');
+    REQUIRE_NODE_EQ(result[3], 2, 1, ParseNode::NodeType::CONCAT, '\0');
+    REQUIRE_NODE_EQ(result[4], -1, -1, ParseNode::NodeType::CHAR, 'b');
+    REQUIRE_NODE_EQ(result[5], 4, 3, ParseNode::NodeType::CONCAT, '\0');
+    REQUIRE_NODE_EQ(result[6], 0, 5, ParseNode::NodeType::CONCAT, '\0');
+  }
+
+  SECTION("bounded repetition nests the optional copies") {
+    auto parsed = Parser{"(a|b){1,3}"}.parse();
+    REQUIRE(parsed.err_msg.empty());
+    auto result = parsed.nodes;
+    REQUIRE(result.size() == 13);
+    // "(a|b)((a|b)((a|b))?)?", the original nodes being the innermost copy.
+    REQUIRE_NODE_EQ(result[2], 0, 1, ParseNode::NodeType::OR, '\0');
+    REQUIRE_NODE_EQ(result[3], 2, -1, ParseNode::NodeType::OPTIONAL, '\0');
+    REQUIRE_NODE_EQ(result[6], 4, 5, ParseNode::NodeType::OR, '\0');
+    REQUIRE_NODE_EQ(result[7], 6, 3, ParseNode::NodeType::CONCAT, '\0');
+    REQUIRE_NODE_EQ(result[8], 7, -1, ParseNode::NodeType::OPTIONAL, '\0');
+    REQUIRE_NODE_EQ(result[11], 9, 10, ParseNode::NodeType::OR, '\0');
+    REQUIRE_NODE_EQ(result[12], 11, 8, ParseNode::NodeType::CONCAT, '\0');
+    REQUIRE(parsed.first_node == 12);
+  }
+
+  SECTION("unbounded repetition") {
+    auto parsed = Parser{"a{2,}"}.parse();
+    auto result = parsed.nodes;
+    REQUIRE(result.size() == 4);
+    REQUIRE_NODE_EQ(result[1], 0, -1, ParseNode::NodeType::ONE_OR_MORE, '\0');
+    REQUIRE_NODE_EQ(result[2], -1, -1, ParseNode::NodeType::CHAR, 'a');
+    REQUIRE_NODE_EQ(result[3], 2, 1, ParseNode::NodeType::CONCAT, '\0');
+
+    result = Parser{"a{0,}"}.parse().nodes;
+    REQUIRE(result.size() == 2);
+    REQUIRE_NODE_EQ(result[1], 0, -1, ParseNode::NodeType::KLEENE_STAR, '\0');
+  }
+
+  SECTION("stacked repetitions") {
+    auto result = Parser{"a{2}*"}.parse().nodes;
+    REQUIRE(result.size() == 4);
+    REQUIRE_NODE_EQ(result[3], 2, -1, ParseNode::NodeType::KLEENE_STAR, '\0');
+    result = Parser{"a+?"}.parse().nodes;
+    REQUIRE(result.size() == 3);
+    REQUIRE_NODE_EQ(result[2], 1, -1, ParseNode::NodeType::OPTIONAL, '\0');
+  }
+
+  SECTION("repetition errors") {
+    REQUIRE_NODE_ERR("a{2,1}", "bad repetition bounds");
+    REQUIRE_NODE_ERR("a|{2}", "nothing to repeat");
+    REQUIRE_NODE_ERR("(a{1000}){1000}", "repetitions make the regex too large");
+  }
+
+  SECTION("character class errors") {
+    REQUIRE_NODE_ERR("a[bc", "unterminated character class");
+    REQUIRE_NODE_ERR("(a[z-a])", "bad character range");
+  }
 }
 
 // NOLINTEND(
@@ -0,0 +1,60 @@
+#include "internal/prefix.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <string>
+#include <string_view>
+
+#include "internal/parser.hpp"
+
+using RM::Impl::create_prefix, RM::Impl::find_candidate, RM::Impl::Parser,
+    RM::Impl::Prefix;
+
+namespace {
+Prefix build(const std::string& pattern) {
+  return create_prefix(Parser{pattern}.parse());
+}
+}  // namespace
+
+TEST_CASE("create_prefix") {
+  SECTION("literals") {
+    REQUIRE(build("abc").literal == "abc");
+    REQUIRE(build("abc*").literal == "ab");
+    REQUIRE(build("ab(c|d)e").literal == "ab");
+    REQUIRE(build("(ab|ab)c").literal == "abc");
+    REQUIRE(build("abc|abd").literal == "ab");
+    REQUIRE(build("(ab)+c").literal == "ab");
+    REQUIRE(build("a?b").literal.empty());
+    REQUIRE(build("(a|b)c").literal.empty());
+  }
+
+  SECTION("first bytes") {
+    const Prefix prefix = build("(a|b)*c|d+");
+    REQUIRE(prefix.first_byte_count == 4);
+    REQUIRE(prefix.first_bytes['a']);
+    REQUIRE(prefix.first_bytes['b']);
+    REQUIRE(prefix.first_bytes['c']);
+    REQUIRE(prefix.first_bytes['d']);
+    REQUIRE(!prefix.nullable);
+    REQUIRE(prefix.is_selective());
+  }
+
+  SECTION("nullable") {
+    const Prefix prefix = build("a*b?");
+    REQUIRE(prefix.nullable);
+    REQUIRE(!prefix.is_selective());
+  }
+
+  SECTION("error") { REQUIRE(!build("(a").valid); }
+}
+
+TEST_CASE("find_candidate") {
+  const std::string_view haystack = "xxabyyabczzd";
+  REQUIRE(find_candidate(build("abc"), haystack, 0) == 6);
+  REQUIRE(find_candidate(build("a(b|c)"), haystack, 0) == 2);
+  REQUIRE(find_candidate(build("a(b|c)"), haystack, 3) == 6);
+  REQUIRE(find_candidate(build("d|c"), haystack, 0) == 8);
+  REQUIRE(find_candidate(build("q"), haystack, 0) == std::string_view::npos);
+  REQUIRE(find_candidate(build("a*"), haystack, 5) == 5);
+  REQUIRE(find_candidate(build("a"), haystack, haystack.size()) ==
+          std::string_view::npos);
+}
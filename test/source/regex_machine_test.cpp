@@ -1,8 +1,21 @@
 #include "regex_machine.hpp"
 
+#include <array>
+#include <atomic>
 #include <catch2/catch_all.hpp>
+#include <deque>
+#include <list>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <thread>
 
-using RM::Matcher;
+using RM::Construction, RM::Engine, RM::LoadedMatcher, RM::Matcher;
+
+// Every engine, for the tests that run on each of them.
+constexpr std::array all_engines{Engine::AUTO,       Engine::NFA,
+                                 Engine::NFA_BITSET, Engine::LAZY_DFA,
+                                 Engine::DFA,        Engine::BITAP};
 
 TEST_CASE("Matcher::match") {
   SECTION("a") {
@@ -118,6 +131,15 @@ TEST_CASE("Matcher::match") {
     REQUIRE(!matcher.match("aba"));
   }
 
+  SECTION("a+b+") {
+    const Matcher matcher{"a+b+"};
+    REQUIRE(matcher.err_msg.empty());
+    REQUIRE(matcher.match("ab"));
+    REQUIRE(matcher.match("aabbb"));
+    REQUIRE(!matcher.match("abab"));
+    REQUIRE(!matcher.match("ba"));
+  }
+
   SECTION("ca(k|v)*e") {
     const Matcher matcher{"ca(k|v)*e"};
     REQUIRE(matcher.err_msg.empty());
@@ -174,6 +196,45 @@ TEST_CASE("Matcher::match") {
     REQUIRE(!matcher.match(""));
   }
 
+  SECTION("[a-z0-9_]+\\@[^.]+\\.(com|org)") {
+    const Matcher matcher{R"([a-z0-9_]+\@[^.]+\.(com|org))"};
+    REQUIRE(matcher.err_msg.empty());
+    REQUIRE(matcher.match("john_42@example.com"));
+    REQUIRE(matcher.match("x@y-z.org"));
+    REQUIRE(!matcher.match("John@example.com"));
+    REQUIRE(!matcher.match("x@a.b.com"));
+    REQUIRE(!matcher.match("x@.com"));
+  }
+
+  SECTION(".") {
+    const Matcher matcher{"a.c"};
+    REQUIRE(matcher.match("abc"));
+    REQUIRE(matcher.match("a.c"));
+    REQUIRE(matcher.match("a\xff" "c"));
+    REQUIRE(!matcher.match("a\nc"));
+    REQUIRE(!matcher.match("ac"));
+  }
+
+  SECTION("[0-9]{4}\\-[0-9]{2}(\\-[0-9]{1,2})?") {
+    const Matcher matcher{R"([0-9]{4}\-[0-9]{2}(\-[0-9]{1,2})?)"};
+    REQUIRE(matcher.err_msg.empty());
+    REQUIRE(matcher.match("2026-10"));
+    REQUIRE(matcher.match("2026-10-6"));
+    REQUIRE(matcher.match("2026-10-16"));
+    REQUIRE(!matcher.match("2026-10-160"));
+    REQUIRE(!matcher.match("226-10"));
+  }
+
+  SECTION("a{1,1000}") {
+    for (const Engine engine : {Engine::NFA_BITSET, Engine::DFA}) {
+      const Matcher matcher{"a{1,1000}", {.engine = engine}};
+      REQUIRE(matcher.err_msg.empty());
+      REQUIRE(matcher.match(std::string(1000, 'a')));
+      REQUIRE(!matcher.match(std::string(1001, 'a')));
+      REQUIRE(!matcher.match(""));
+    }
+  }
+
   SECTION("errors") {
     // Errors are tested in detail in parsing_test.cpp
     Matcher matcher{"(a"};
@@ -192,3 +253,517 @@ TEST_CASE("Matcher::match") {
     REQUIRE(!matcher.err_msg.empty());
   }
 }
+
+TEST_CASE("Matcher engines agree") {
+  const std::vector<std::string> patterns{
+      "a", "ab", "a|b", "(xy)*", "(a|b|c)(xyz)*", "(ab)?c*", "(ab)+c*",
+      "ca(k|v)*e", "(a|b)*a(a|b)", R"(((\(\))\?)+)", "[a-c]+[^a]?",
+      "(.|x)y*", "[]a-]*b", "(ab){1,3}c?", "[a-c]{2}x{0,2}",
+      "(a|b)*a(a|b){2}", "(xy){2,}"};
+  const std::vector<std::string> inputs{
+      "",     "a",     "b",     "ab",    "xy",     "xyxy",   "axyz",
+      "abcc", "ababc", "cae",   "cake",  "cavvve", "cape",   "aab",
+      "bab",  "abba",  "()?",   "()?()?", "xyx",   "ccccc",  "a]-b",
+      "cbz",  "\ny",  "xyy"};
+  for (const Construction construction :
+       {Construction::THOMPSON, Construction::GLUSHKOV}) {
+    for (const Engine engine : all_engines) {
+      for (const std::string& pattern : patterns) {
+        const Matcher reference{std::string{pattern},
+                                {.engine = Engine::NFA}};
+        const Matcher matcher{
+            std::string{pattern},
+            {.engine = engine, .construction = construction}};
+        REQUIRE(matcher.err_msg.empty());
+        for (const std::string& input : inputs) {
+          INFO(static_cast<int>(construction)
+               << "/" << static_cast<int>(engine) << ": " << pattern << " / "
+               << input);
+          REQUIRE(matcher.match(input) == reference.match(input));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Matcher::match over ranges") {
+  const std::vector<std::string> inputs{"", "cae", "cake", "cavvve", "cape",
+                                        "ca", "cakee"};
+  for (const Engine engine : all_engines) {
+    const Matcher matcher{"ca(k|v)*e", {.engine = engine}};
+    for (const std::string& input : inputs) {
+      INFO(static_cast<int>(engine) << ": " << input);
+      const bool expected = matcher.match(input);
+      REQUIRE(matcher.match(std::span<const char>{input}) == expected);
+      REQUIRE(matcher.match(std::deque<char>(input.begin(), input.end())) ==
+              expected);
+      REQUIRE(matcher.match(std::list<char>(input.begin(), input.end())) ==
+              expected);
+
+      // Split into single chars, with empty chunks in between and around.
+      std::vector<std::string_view> chunks{""};
+      for (size_t i = 0; i < input.size(); ++i) {
+        chunks.push_back(std::string_view{input}.substr(i, 1));
+        chunks.emplace_back();
+      }
+      REQUIRE(matcher.match(chunks) == expected);
+      const std::vector<std::string> halves{
+          input.substr(0, input.size() / 2), input.substr(input.size() / 2)};
+      REQUIRE(matcher.match(halves) == expected);
+    }
+  }
+
+  SECTION("string literals stop at the terminator") {
+    const Matcher matcher{"cake"};
+    REQUIRE(matcher.match("cake"));
+    const char chars[] = {'c', 'a', 'k', 'e'};
+    REQUIRE(matcher.match(std::span{chars}));
+  }
+
+  SECTION("chunks share statistics and the prefix check") {
+    const Matcher matcher{"cake", {.engine = Engine::DFA}};
+    const std::vector<std::string_view> chunks{"c", "ak", "", "e"};
+    RM::MatchStats stats;
+    REQUIRE(matcher.match(chunks, stats));
+    REQUIRE(stats.bytes == 4);
+    REQUIRE(stats.allocations == 0);
+    REQUIRE(!matcher.match(std::vector<std::string_view>{"c", "o", "ke"},
+                           stats));
+    REQUIRE(stats.bytes == 4);
+  }
+}
+
+TEST_CASE("Matcher DFA state limit") {
+  const Matcher small{"(a|b)*a(a|b)(a|b)(a|b)(a|b)",
+                      {.engine = Engine::DFA, .dfa_state_limit = 8}};
+  REQUIRE(small.err_msg == "DFA state limit exceeded");
+  REQUIRE(!small.match("aaaaa"));
+
+  const Matcher large{"(a|b)*a(a|b)(a|b)(a|b)(a|b)",
+                      {.engine = Engine::DFA, .dfa_state_limit = 64}};
+  REQUIRE(large.err_msg.empty());
+  REQUIRE(large.match("aaaaa"));
+}
+
+TEST_CASE("Matcher bit-parallel engine limit") {
+  const std::string long_pattern = std::string(64, 'a') + "b*";
+  const Matcher automatic{std::string{long_pattern}};
+  REQUIRE(automatic.err_msg.empty());
+  REQUIRE(automatic.match(std::string(64, 'a') + "bb"));
+  REQUIRE(!automatic.match(std::string(63, 'a') + "bb"));
+
+  const Matcher forced{std::string{long_pattern}, {.engine = Engine::BITAP}};
+  REQUIRE(forced.err_msg == "too many characters for the bit-parallel engine");
+
+  const Matcher fits{std::string(64, 'a'), {.engine = Engine::BITAP}};
+  REQUIRE(fits.err_msg.empty());
+  REQUIRE(fits.match(std::string(64, 'a')));
+}
+
+TEST_CASE("Matcher nested nullable repetitions") {
+  // Every copy of "a?" reaches all the 5000 copies after it, so closures
+  // and follow sets grow with the square of the pattern's expansion.
+  const std::string pattern = "((a?){1000}){5}b";
+  for (const Construction construction :
+       {Construction::THOMPSON, Construction::GLUSHKOV}) {
+    for (const Engine engine : all_engines) {
+      for (const bool simplify : {true, false}) {
+        const Matcher matcher{pattern, {.engine = engine,
+                                        .construction = construction,
+                                        .dfa_state_limit = 64,
+                                        .simplify = simplify}};
+        INFO(static_cast<int>(construction)
+             << " " << static_cast<int>(engine) << " " << simplify);
+        if (construction == Construction::GLUSHKOV) {
+          REQUIRE(matcher.err_msg ==
+                  "too many follow positions for the Glushkov construction");
+        } else if (engine == Engine::DFA) {
+          REQUIRE(matcher.err_msg == "DFA state limit exceeded");
+        } else if (engine == Engine::BITAP) {
+          REQUIRE(matcher.err_msg ==
+                  "too many characters for the bit-parallel engine");
+        } else {
+          REQUIRE(matcher.err_msg.empty());
+          REQUIRE(matcher.match("aab"));
+          REQUIRE(matcher.match("b"));
+          REQUIRE(!matcher.match("aac"));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Matcher never_newline") {
+  const Matcher across{"x[^q]*z"};
+  REQUIRE(across.find("x\nz\nxz") == RM::Span{0, 6});
+  REQUIRE(across.match("x\nz"));
+
+  const Matcher lines{"x[^q]*z", {.never_newline = true}};
+  REQUIRE(lines.find("x\nz\nxz") == RM::Span{4, 6});
+  REQUIRE(!lines.match("x\nz"));
+  REQUIRE(lines.match("xaz"));
+
+  const Matcher newline{"a(\n|b)", {.never_newline = true}};
+  REQUIRE(newline.err_msg.empty());
+  REQUIRE(newline.match("ab"));
+  REQUIRE(!newline.match("a\n"));
+}
+
+TEST_CASE("Matcher simplification") {
+  std::string pattern;
+  for (int k = 0; k < 33; ++k) {
+    pattern += "(a|b)";
+  }
+  const Matcher simplified{std::string{pattern}, {.engine = Engine::BITAP}};
+  REQUIRE(simplified.err_msg.empty());
+  REQUIRE(simplified.simplify_stats() ==
+          RM::SimplifyStats{.nodes_before = 131, .nodes_after = 65});
+  REQUIRE(simplified.match(std::string(33, 'b')));
+  REQUIRE(!simplified.match(std::string(32, 'b') + "c"));
+
+  const Matcher plain{std::string{pattern},
+                      {.engine = Engine::BITAP, .simplify = false}};
+  REQUIRE(plain.err_msg == "too many characters for the bit-parallel engine");
+  REQUIRE(plain.simplify_stats() ==
+          RM::SimplifyStats{.nodes_before = 131, .nodes_after = 131});
+
+  for (const std::string p : {"(a*)*b", "abc|abd|ab", "(x?|yz)+w"}) {
+    const Matcher on{std::string{p}};
+    const Matcher off{std::string{p}, {.simplify = false}};
+    REQUIRE(on.simplify_stats().nodes_after <
+            off.simplify_stats().nodes_after);
+    for (const std::string input : {"", "b", "aab", "ab", "abd", "yzw", "w"}) {
+      REQUIRE(on.match(input) == off.match(input));
+    }
+  }
+}
+
+TEST_CASE("Matcher::find") {
+  const Matcher matcher{"ca(k|v)*e"};
+  REQUIRE(matcher.find("the cavvve is cakey") == RM::Span{4, 10});
+  REQUIRE(!matcher.find("cape"));
+
+  std::vector<RM::Span> spans;
+  for (const RM::Span span : matcher.find_all("cae,cake;cavvve!")) {
+    spans.push_back(span);
+  }
+  REQUIRE(spans == std::vector<RM::Span>{{0, 3}, {4, 8}, {9, 15}});
+
+  const Matcher invalid{"(a"};
+  REQUIRE(!invalid.find("a"));
+  REQUIRE(invalid.find_all("a").begin() == std::default_sentinel);
+}
+
+TEST_CASE("Matcher::match_parallel") {
+  std::string input;
+  for (size_t i = 0; i < 100000; ++i) {
+    input += i % 3 == 0 ? "cake" : "cavve";
+  }
+  for (const Engine engine : {Engine::NFA_BITSET, Engine::DFA,
+                              Engine::BITAP}) {
+    const Matcher matcher{"(ca(k|v)*e)*", {.engine = engine}};
+    REQUIRE(matcher.match_parallel(input, 4));
+    REQUIRE(!matcher.match_parallel(input + "ca", 4));
+  }
+}
+
+TEST_CASE("Matcher::match_batch") {
+  const std::vector<std::string> strings{"", "cae", "cake", "cape",
+                                         "cavvve", "xcake", "ca", "cakkkke"};
+  std::vector<std::string_view> inputs;
+  for (size_t i = 0; i < 1000; ++i) {
+    inputs.emplace_back(strings[i % strings.size()]);
+  }
+  for (const Engine engine : all_engines) {
+    const Matcher matcher{"ca(k|v)*e", {.engine = engine}};
+    const std::unique_ptr<bool[]> results{new bool[inputs.size()]};
+    matcher.match_batch(inputs, {results.get(), inputs.size()}, 4);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      INFO(static_cast<int>(engine) << ": " << inputs[i]);
+      REQUIRE(results[i] == matcher.match(std::string{inputs[i]}));
+    }
+  }
+}
+
+TEST_CASE("Matcher::Session") {
+  const std::vector<std::string> patterns{"ca(k|v)*e", "(ab)?c*",
+                                          "(a|b)*a(a|b)"};
+  const std::vector<std::string> inputs{"", "cae", "cakkve", "abccc",
+                                        "ababa", "cape", "bbab"};
+  for (const Engine engine : all_engines) {
+    for (const std::string& pattern : patterns) {
+      const Matcher matcher{std::string{pattern}, {.engine = engine}};
+      for (const std::string& input : inputs) {
+        // Every split of the input into two chunks gives the same verdict.
+        for (size_t split = 0; split <= input.size(); ++split) {
+          INFO(static_cast<int>(engine)
+               << ": " << pattern << " / " << input << " @ " << split);
+          Matcher::Session session = matcher.session();
+          session.feed(std::string_view{input}.substr(0, split));
+          session.feed(std::string_view{input}.substr(split));
+          REQUIRE(session.finish() == matcher.match(std::string{input}));
+        }
+      }
+    }
+  }
+
+  SECTION("dead input is reported early") {
+    const Matcher matcher{"ca(k|v)*e"};
+    Matcher::Session session = matcher.session();
+    REQUIRE(session.feed("cak"));
+    REQUIRE(!session.is_dead());
+    REQUIRE(!session.feed("x"));
+    REQUIRE(session.is_dead());
+    REQUIRE(!session.feed("e"));
+    REQUIRE(!session.finish());
+  }
+
+  SECTION("reset") {
+    for (const Engine engine : {Engine::NFA_BITSET, Engine::LAZY_DFA,
+                                Engine::DFA, Engine::BITAP}) {
+      const Matcher matcher{"ca(k|v)*e", {.engine = engine}};
+      Matcher::Session session = matcher.session();
+      REQUIRE(!session.feed("cx"));
+      session.reset();
+      REQUIRE(!session.is_dead());
+      REQUIRE(session.feed("cake"));
+      REQUIRE(session.finish());
+    }
+  }
+
+  SECTION("lazy DFA falling back to the NFA") {
+    const Matcher matcher{
+        "(a|b)*a(a|b)(a|b)(a|b)",
+        {.engine = Engine::LAZY_DFA,
+         .lazy_dfa_cache_limit = 6000,
+         .lazy_dfa_overflow = RM::CacheOverflow::FALLBACK}};
+    Matcher::Session session = matcher.session();
+    REQUIRE(session.feed("abbabaab"));
+    REQUIRE(session.feed("abbbaaab"));
+    REQUIRE(session.finish() == matcher.match("abbabaababbbaaab"));
+    REQUIRE(session.feed("bbbb"));
+    REQUIRE(!session.finish());
+  }
+
+  SECTION("invalid pattern") {
+    const Matcher invalid{"(a"};
+    Matcher::Session session = invalid.session();
+    REQUIRE(session.is_dead());
+    REQUIRE(!session.feed("a"));
+    REQUIRE(!session.finish());
+  }
+}
+
+TEST_CASE("Matcher::save and LoadedMatcher") {
+  const std::vector<std::string> inputs{"", "cae", "cakkve", "cape",
+                                        "xcake", "ca"};
+  for (const Engine engine : all_engines) {
+    INFO(static_cast<int>(engine));
+    const Matcher matcher{"ca(k|v)*e", {.engine = engine}};
+    const std::vector<char> blob = matcher.save();
+    REQUIRE(!blob.empty());
+    const LoadedMatcher loaded{blob};
+    REQUIRE(loaded.err_msg.empty());
+    for (const std::string& input : inputs) {
+      INFO(input);
+      REQUIRE(loaded.match(input) == matcher.match(input));
+    }
+  }
+
+  SECTION("options are kept") {
+    const Matcher matcher{"a[^q]b", {.never_newline = true}};
+    const std::vector<char> blob = matcher.save();
+    const LoadedMatcher loaded{blob};
+    REQUIRE(loaded.match("axb"));
+    REQUIRE(!loaded.match("a\nb"));
+  }
+
+  SECTION("invalid blobs") {
+    REQUIRE(Matcher{"(a"}.save().empty());
+    REQUIRE(LoadedMatcher{{}}.err_msg == "truncated blob");
+    const std::string text = "not an automaton";
+    const LoadedMatcher wrong{text};
+    REQUIRE(wrong.err_msg == "not a saved matcher");
+    REQUIRE(!wrong.match(""));
+    std::vector<char> blob = Matcher{"ab"}.save();
+    blob.resize(blob.size() - 4);
+    REQUIRE(LoadedMatcher{blob}.err_msg == "truncated blob");
+  }
+}
+
+TEST_CASE("Matcher statistics") {
+  using RM::MatchStats;
+  for (const Engine engine : all_engines) {
+    INFO(static_cast<int>(engine));
+    const Matcher matcher{"ca(k|v)*e", {.engine = engine}};
+    MatchStats stats;
+    REQUIRE(matcher.match("cakve", stats));
+    REQUIRE(stats.matches == 1);
+    REQUIRE(stats.bytes == 5);
+    REQUIRE(stats.active_states >= 5);
+    REQUIRE(stats.max_active_states >= 1);
+
+    // Reading stops at the first byte that fails, and nothing is read when
+    // the literal prefix does not match.
+    REQUIRE(!matcher.match("caxve", stats));
+    REQUIRE(!matcher.match("dog", stats));
+    REQUIRE(stats.matches == 3);
+    REQUIRE(stats.bytes == 8);
+    // Without collect_stats, the matcher keeps nothing.
+    REQUIRE(matcher.stats() == MatchStats{});
+  }
+
+  SECTION("engine counters") {
+    const Matcher dfa{"ca(k|v)*e", {.engine = Engine::DFA}};
+    MatchStats dfa_stats;
+    REQUIRE(dfa.match("cake", dfa_stats));
+    REQUIRE(dfa_stats.active_states == 4);
+    REQUIRE(dfa_stats.max_active_states == 1);
+    REQUIRE(dfa_stats.closure_expansions == 0);
+    REQUIRE(dfa_stats.allocations == 0);
+
+    const Matcher nfa{"ca(k|v)*e", {.engine = Engine::NFA_BITSET}};
+    MatchStats nfa_stats;
+    REQUIRE(nfa.match("cake", nfa_stats));
+    REQUIRE(nfa_stats.closure_expansions >= 5);
+    REQUIRE(nfa_stats.allocations > 0);
+
+    const Matcher lazy{"ca(k|v)*e", {.engine = Engine::LAZY_DFA}};
+    MatchStats first;
+    REQUIRE(lazy.match("cake", first));
+    REQUIRE(first.cache_misses == 4);
+    REQUIRE(first.allocations > 0);
+    MatchStats second;
+    REQUIRE(lazy.match("cake", second));
+    REQUIRE(second.cache_hits == 4);
+    REQUIRE(second.cache_misses == 0);
+    REQUIRE(second.allocations == 0);
+  }
+
+  SECTION("collected by the matcher") {
+    const Matcher matcher{"ca(k|v)*e",
+                          {.engine = Engine::DFA, .collect_stats = true}};
+    const Matcher copy = matcher;
+    REQUIRE(matcher.match("cake"));
+    REQUIRE(!copy.match("caxe"));
+    std::jthread other{[&]() { REQUIRE(matcher.match("cavvve")); }};
+    other.join();
+    const MatchStats stats = matcher.stats();
+    REQUIRE(stats.matches == 3);
+    REQUIRE(stats.bytes == 13);
+    REQUIRE(stats.max_active_states == 1);
+    REQUIRE(copy.stats() == stats);
+    // Neither is counted, whatever engine they run on.
+    REQUIRE(matcher.match_parallel("cake", 2));
+    const std::vector<std::string_view> batch{"cake", "cae"};
+    std::array<bool, 2> results{};
+    matcher.match_batch(batch, results, 2);
+    const Matcher nfa{"ca(k|v)*e",
+                      {.engine = Engine::NFA, .collect_stats = true}};
+    REQUIRE(nfa.match_parallel("cake", 2));
+    REQUIRE(matcher.stats() == stats);
+    REQUIRE(nfa.stats() == MatchStats{});
+    REQUIRE(Matcher{"ca(k|v)*e", {.collect_stats = true}}.stats() ==
+            MatchStats{});
+  }
+}
+
+TEST_CASE("MatcherCache") {
+  using Stats = RM::MatcherCache::Stats;
+  RM::MatcherCache cache{2};
+  REQUIRE(cache.get("ca(k|v)*e").match("cake"));
+  REQUIRE(cache.get("ca(k|v)*e").match("cave"));
+  REQUIRE(cache.stats() == Stats{.hits = 1, .misses = 1, .evictions = 0});
+
+  // Other options are another entry.
+  const Matcher dfa = cache.get("ca(k|v)*e", {.engine = Engine::DFA});
+  REQUIRE(dfa.match("cae"));
+  REQUIRE(cache.size() == 2);
+
+  // The least recently used entry, the DFA one, is evicted.
+  REQUIRE(cache.get("ca(k|v)*e").match("cae"));
+  REQUIRE(!cache.get("dog").match("cake"));
+  REQUIRE(cache.stats() == Stats{.hits = 2, .misses = 3, .evictions = 1});
+  REQUIRE(cache.get("ca(k|v)*e").match("cae"));
+  REQUIRE(cache.stats().hits == 3);
+  // A matcher handed out before the eviction still works.
+  REQUIRE(dfa.match("cavke"));
+
+  const Matcher invalid = cache.get("(a");
+  REQUIRE(invalid.err_msg == "unbalanced parens");
+  REQUIRE(cache.get("(a").err_msg == "unbalanced parens");
+
+  cache.clear();
+  REQUIRE(cache.size() == 0);
+
+  SECTION("zero capacity") {
+    RM::MatcherCache none{0};
+    REQUIRE(none.get("a").match("a"));
+    REQUIRE(none.get("a").match("a"));
+    REQUIRE(none.size() == 0);
+    REQUIRE(none.stats().misses == 2);
+  }
+
+  SECTION("shared between threads") {
+    RM::MatcherCache shared{8};
+    std::vector<std::jthread> threads;
+    std::atomic<int> failures{0};
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&shared, &failures, t]() {
+        for (int i = 0; i < 200; ++i) {
+          const std::string pattern = "a" + std::to_string((i + t) % 12);
+          if (!shared.get(pattern).match(std::string{pattern})) {
+            ++failures;
+          }
+        }
+      });
+    }
+    threads.clear();
+    REQUIRE(failures == 0);
+    const Stats stats = shared.stats();
+    REQUIRE(stats.hits + stats.misses == 800);
+    REQUIRE(shared.size() <= 8);
+  }
+}
+
+TEST_CASE("RegexSet::match") {
+  const RM::RegexSet set{{"ca(k|v)*e", "c(a|o)+", "(c|a|k|e)*", "dog"}};
+  REQUIRE(set.err_msg.empty());
+  REQUIRE(set.size() == 4);
+  REQUIRE(set.match("cake") == std::vector<size_t>{0, 2});
+  REQUIRE(set.match("caoa") == std::vector<size_t>{1});
+  REQUIRE(set.match("dog") == std::vector<size_t>{3});
+  REQUIRE(set.match("") == std::vector<size_t>{2});
+  REQUIRE(set.match("cat").empty());
+
+  const RM::RegexSet invalid{{"a", "(b"}};
+  REQUIRE(invalid.err_msg == "pattern 1: unbalanced parens");
+  REQUIRE(invalid.match("a").empty());
+}
+
+TEST_CASE("StaticMatcher::match") {
+  using Cake = RM::StaticMatcher<"ca(k|v)*e">;
+  static_assert(Cake::match("cae"));
+  static_assert(Cake::match("cakvke"));
+  static_assert(!Cake::match("cape"));
+  static_assert(!Cake::match(""));
+  static_assert(RM::StaticMatcher<"(ab)?c*">::match(""));
+  static_assert(RM::StaticMatcher<R"(a\*)">::match("a*"));
+  static_assert(RM::StaticMatcher<"[a-f0-9]+">::match("c0ffee"));
+  static_assert(!RM::StaticMatcher<"[^0-9].">::match("0x"));
+  static_assert(RM::StaticMatcher<"(ab){2,3}">::match("ababab"));
+  static_assert(!RM::StaticMatcher<"(ab){2,3}">::match("ab"));
+
+  const std::vector<std::string> inputs{"", "a", "ab", "aab", "bab", "abba",
+                                        "aaaaaaaaab", "bbbbbbbbbbbab"};
+  const Matcher reference{"(a|b)*a(a|b)"};
+  const RM::StaticMatcher<"(a|b)*a(a|b)"> matcher;
+  for (const std::string& input : inputs) {
+    REQUIRE(matcher.match(input) == reference.match(std::string{input}));
+  }
+
+  // More than 8 characters, so that several follow tables are used.
+  using Long = RM::StaticMatcher<"(abcdefghij)+k">;
+  REQUIRE(Long::match("abcdefghijabcdefghijk"));
+  REQUIRE(!Long::match("abcdefghijabcdefghij"));
+}
@@ -0,0 +1,39 @@
+#include "internal/regex_set.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <vector>
+
+#include "internal/parser.hpp"
+
+using RM::Impl::create_set, RM::Impl::NFA, RM::Impl::Parser,
+    RM::Impl::SetNFA;
+
+TEST_CASE("create_set") {
+  const SetNFA set =
+      create_set({Parser{"ab"}.parse(), Parser{"a*"}.parse()});
+  REQUIRE(set.nfa.error == NFA::err_state::OK);
+  // Start state, 3 states for "ab", 4 states for "a*".
+  REQUIRE(set.nfa.size == 8);
+  REQUIRE(set.finals == std::vector<NFA::state>{3, 7});
+  REQUIRE(set.nfa.eps_transitions[0] == std::vector<NFA::state>{1, 4});
+}
+
+TEST_CASE("SetNFA::matches") {
+  const SetNFA set = create_set(
+      {Parser{"ab"}.parse(), Parser{"a*"}.parse(), Parser{"(a|b)+"}.parse()});
+  REQUIRE(set.matches("ab") == std::vector<size_t>{0, 2});
+  REQUIRE(set.matches("aa") == std::vector<size_t>{1, 2});
+  REQUIRE(set.matches("") == std::vector<size_t>{1});
+  REQUIRE(set.matches("abc").empty());
+}
+
+TEST_CASE("SetNFA::matches without precomputed closures") {
+  // Every copy of "a?" reaches all the copies after it.
+  const SetNFA set = create_set(
+      {Parser{"((a?){1000}){5}b"}.parse(), Parser{"a*"}.parse()});
+  REQUIRE(!set.nfa.has_closures());
+  REQUIRE(set.matches("aab") == std::vector<size_t>{0});
+  REQUIRE(set.matches("b") == std::vector<size_t>{0});
+  REQUIRE(set.matches("aaa") == std::vector<size_t>{1});
+  REQUIRE(set.matches("") == std::vector<size_t>{1});
+}
@@ -4,13 +4,15 @@
 #include "internal/scanner.hpp"
 
 #include <catch2/catch_all.hpp>
-#include <unordered_set>
+#include <initializer_list>
+#include <utility>
+#include <vector>
 
-using RM::Impl::Scanner;
+using RM::Impl::ByteSet, RM::Impl::Scanner;
 
 void REQUIRE_SCANNER_EQ(std::string&& input, std::string&& regex,
                         size_t node_charcount, int paren_balance,
-                        std::unordered_set<size_t> escapes) {
+                        std::vector<size_t> escapes) {
   Scanner result{input};
   REQUIRE(result.regex == regex);
   REQUIRE(result.node_charcount == node_charcount);
@@ -60,19 +62,19 @@ TEST_CASE("Scanner::pop_token") {
 TEST_CASE("Scanner::Scanner") {
   // Non-escaped strings
   REQUIRE_SCANNER_EQ("", "", 0, 0, {});
-  REQUIRE_SCANNER_EQ("a", "a", 1, 0, std::unordered_set<size_t>{});
-  REQUIRE_SCANNER_EQ("ab", "a.b", 3, 0, std::unordered_set<size_t>{});
-  REQUIRE_SCANNER_EQ("abc", "a.b.c", 5, 0, std::unordered_set<size_t>{});
-  REQUIRE_SCANNER_EQ("abcd", "a.b.c.d", 7, 0, std::unordered_set<size_t>{});
-  REQUIRE_SCANNER_EQ("a|bc", "a|b.c", 5, 0, std::unordered_set<size_t>{});
-  REQUIRE_SCANNER_EQ("ab|c", "a.b|c", 5, 0, std::unordered_set<size_t>{});
+  REQUIRE_SCANNER_EQ("a", "a", 1, 0, std::vector<size_t>{});
+  REQUIRE_SCANNER_EQ("ab", "a.b", 3, 0, std::vector<size_t>{});
+  REQUIRE_SCANNER_EQ("abc", "a.b.c", 5, 0, std::vector<size_t>{});
+  REQUIRE_SCANNER_EQ("abcd", "a.b.c.d", 7, 0, std::vector<size_t>{});
+  REQUIRE_SCANNER_EQ("a|bc", "a|b.c", 5, 0, std::vector<size_t>{});
+  REQUIRE_SCANNER_EQ("ab|c", "a.b|c", 5, 0, std::vector<size_t>{});
   REQUIRE_SCANNER_EQ("a*b*c?d|e", "a*.b*.c?.d|e", 12, 0,
-                     std::unordered_set<size_t>{});
+                     std::vector<size_t>{});
   REQUIRE_SCANNER_EQ("(a?b*)(c)(def)?gh|iabc",
                      "(a?.b*).(c).(d.e.f)?.g.h|i.a.b.c", 26, 0,
-                     std::unordered_set<size_t>{});
-  REQUIRE_SCANNER_EQ("(a", "(a", 1, 1, std::unordered_set<size_t>{});
-  REQUIRE_SCANNER_EQ("a)", "a)", 1, -1, std::unordered_set<size_t>{});
+                     std::vector<size_t>{});
+  REQUIRE_SCANNER_EQ("(a", "(a", 1, 1, std::vector<size_t>{});
+  REQUIRE_SCANNER_EQ("a)", "a)", 1, -1, std::vector<size_t>{});
 
   // Escaped strings
   REQUIRE_SCANNER_EQ("a\\)", "a.)", 3, 0, {2});
@@ -84,6 +86,92 @@ TEST_CASE("Scanner::Scanner") {
   REQUIRE_SCANNER_EQ("\\((ab)?\\)", "(.(a.b)?.)", 8, 0, {0, 9});
 }
 
+TEST_CASE("Scanner character classes") {
+  const auto set_of = [](std::initializer_list<std::pair<char, char>> ranges) {
+    ByteSet result;
+    for (const auto& [first, last] : ranges) {
+      result.insert_range(first, last);
+    }
+    return result;
+  };
+
+  SECTION("placeholders") {
+    Scanner scanner{"a[b-d]*.e"};
+    REQUIRE(scanner.err_msg.empty());
+    REQUIRE(scanner.regex == "a.[*.[.e");
+    REQUIRE(scanner.node_charcount == 8);
+    REQUIRE(scanner.classes == std::vector<size_t>{2, 5});
+    REQUIRE(scanner.sets ==
+            std::vector<ByteSet>{set_of({{'b', 'd'}}), ByteSet::wildcard()});
+    scanner.pop();
+    REQUIRE(scanner.next_class() == -1);
+    scanner.pop();
+    REQUIRE(scanner.next_class() == 0);
+  }
+
+  SECTION("members") {
+    REQUIRE(Scanner{"[a-cx0-9]"}.sets[0] ==
+            set_of({{'a', 'c'}, {'x', 'x'}, {'0', '9'}}));
+    REQUIRE(Scanner{"[]a]"}.sets[0] == set_of({{']', ']'}, {'a', 'a'}}));
+    REQUIRE(Scanner{"[-a-]"}.sets[0] == set_of({{'-', '-'}, {'a', 'a'}}));
+    REQUIRE(Scanner{"[\\]\\-]"}.sets[0] == set_of({{']', ']'}, {'-', '-'}}));
+    REQUIRE(Scanner{"[.|(]"}.sets[0] ==
+            set_of({{'.', '.'}, {'|', '|'}, {'(', '('}}));
+    REQUIRE(Scanner{"[^a]"}.sets[0] == set_of({{'a', 'a'}}).complement());
+    REQUIRE(Scanner{"[^]]"}.sets[0] == set_of({{']', ']'}}).complement());
+  }
+
+  SECTION("escaped brackets and dots are characters") {
+    const Scanner scanner{"\\[\\."};
+    REQUIRE(scanner.regex == "[..");
+    REQUIRE(scanner.classes.empty());
+    REQUIRE(scanner.escapes == std::vector<size_t>{0, 2});
+  }
+
+  SECTION("errors") {
+    REQUIRE(Scanner{"[ab"}.err_msg == "unterminated character class");
+    REQUIRE(Scanner{"[]"}.err_msg == "unterminated character class");
+    REQUIRE(Scanner{"[a\\]"}.err_msg == "unterminated character class");
+    REQUIRE(Scanner{"[z-a]"}.err_msg == "bad character range");
+  }
+
+  static_assert(Scanner{"[^\n]"}.sets[0] == ByteSet::wildcard());
+}
+
+TEST_CASE("Scanner repetitions") {
+  using Bounds = Scanner::Bounds;
+
+  SECTION("placeholders") {
+    const Scanner scanner{"a{2}b{1,}(c){0,3}d"};
+    REQUIRE(scanner.err_msg.empty());
+    REQUIRE(scanner.regex == "a{.b{.(c){.d");
+    REQUIRE(scanner.node_charcount == 7);
+    REQUIRE(scanner.repeats == std::vector<size_t>{1, 4, 9});
+    REQUIRE(scanner.bounds ==
+            std::vector<Bounds>{{2, 2}, {1, Bounds::UNBOUNDED}, {0, 3}});
+  }
+
+  SECTION("escaped braces are characters") {
+    const Scanner scanner{"a\\{2}"};
+    REQUIRE(scanner.regex == "a.{.2.}");
+    REQUIRE(scanner.repeats.empty());
+  }
+
+  SECTION("errors") {
+    REQUIRE(Scanner{"a{"}.err_msg == "bad repetition");
+    REQUIRE(Scanner{"a{}"}.err_msg == "bad repetition");
+    REQUIRE(Scanner{"a{,2}"}.err_msg == "bad repetition");
+    REQUIRE(Scanner{"a{1,2"}.err_msg == "bad repetition");
+    REQUIRE(Scanner{"a{x}"}.err_msg == "bad repetition");
+    REQUIRE(Scanner{"a{3,2}"}.err_msg == "bad repetition bounds");
+    REQUIRE(Scanner{"a{0}"}.err_msg == "bad repetition bounds");
+    REQUIRE(Scanner{"a{1001}"}.err_msg == "repetition count too large");
+    REQUIRE(Scanner{"a{1,99999999999999999999}"}.err_msg ==
+            "repetition count too large");
+    REQUIRE(Scanner{"a{1000}"}.err_msg.empty());
+  }
+}
+
 // NOLINTEND(
 //   bugprone-easily-swappable-parameters,
 // )
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "internal/search.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "internal/nfa_creation.hpp"
+#include "internal/parser.hpp"
+#include "internal/prefix.hpp"
+
+using RM::Impl::create_from_parse, RM::Impl::create_prefix,
+    RM::Impl::Matches, RM::Impl::NFA, RM::Impl::Parser, RM::Impl::Prefix,
+    RM::Impl::Searcher, RM::Impl::Span;
+
+namespace {
+struct compiled {
+  explicit compiled(const std::string& pattern)
+      : nfa{create_from_parse(Parser{pattern}.parse())},
+        prefix{create_prefix(Parser{pattern}.parse())} {}
+  NFA nfa;
+  Prefix prefix;
+};
+
+std::optional<Span> find(const std::string& pattern, std::string_view s,
+                         size_t from = 0) {
+  const compiled c{pattern};
+  return Searcher{c.nfa, c.prefix}.find(s, from);
+}
+
+std::vector<Span> find_all(const std::string& pattern, std::string_view s) {
+  const compiled c{pattern};
+  std::vector<Span> result;
+  for (const Span span : Matches{c.nfa, c.prefix, s}) {
+    result.push_back(span);
+  }
+  return result;
+}
+}  // namespace
+
+TEST_CASE("Searcher::find") {
+  SECTION("leftmost") {
+    REQUIRE(find("abc", "xxabcxxabc") == Span{2, 5});
+    REQUIRE(find("abc", "xxabcxxabc", 3) == Span{7, 10});
+    REQUIRE(find("abcd|b", "xabcd") == Span{1, 5});
+    REQUIRE(find("b|abcd", "xabce") == Span{2, 3});
+  }
+
+  SECTION("longest") {
+    REQUIRE(find("a+", "baaab") == Span{1, 4});
+    REQUIRE(find("ab|abcd", "abcd") == Span{0, 4});
+    REQUIRE(find("(a|b)*c", "xababcab") == Span{1, 6});
+  }
+
+  SECTION("empty matches") {
+    REQUIRE(find("a*", "baa") == Span{0, 0});
+    REQUIRE(find("a*", "") == Span{0, 0});
+    REQUIRE(find("a*", "baa", 3) == Span{3, 3});
+  }
+
+  SECTION("no match") {
+    REQUIRE(!find("abc", "ababab"));
+    REQUIRE(!find("abc", ""));
+    REQUIRE(!find("a", "a", 2));
+  }
+
+  SECTION("without precomputed closures") {
+    compiled c{"(a|b)*c"};
+    c.nfa.closure_offsets.clear();
+    REQUIRE(!c.nfa.has_closures());
+    Searcher searcher{c.nfa, c.prefix};
+    REQUIRE(searcher.find("xababcab", 0) == Span{1, 6});
+    REQUIRE(searcher.find("xababcab", 6) == std::nullopt);
+  }
+}
+
+TEST_CASE("Matches") {
+  REQUIRE(find_all("ab", "abxabab") ==
+          std::vector<Span>{{0, 2}, {3, 5}, {5, 7}});
+  REQUIRE(find_all("a*", "baa") ==
+          std::vector<Span>{{0, 0}, {1, 3}, {3, 3}});
+  REQUIRE(find_all("x(a|b)+", "xaxbbyx") ==
+          std::vector<Span>{{0, 2}, {2, 5}});
+  REQUIRE(find_all("q", "abc").empty());
+
+  SECTION("pending matches") {
+    // "a" matches at once, while a thread of "a[ab]*c" that started before
+    // it runs on and may still replace it.
+    REQUIRE(find_all("a|a[ab]*c", "aaab") ==
+            std::vector<Span>{{0, 1}, {1, 2}, {2, 3}});
+    REQUIRE(find_all("a|a[ab]*c", "aaabc") == std::vector<Span>{{0, 5}});
+    REQUIRE(find_all("xa*y|a", "xaaxaay") ==
+            std::vector<Span>{{1, 2}, {2, 3}, {3, 7}});
+  }
+
+  SECTION("in linear time") {
+    // Every match is pending until the end of the input. Searching again
+    // from each match would read the input once per match.
+    const auto seconds = [](size_t n) {
+      const compiled c{"a|a[ab]*c"};
+      const std::string s(n, 'a');
+      const auto begin = std::chrono::steady_clock::now();
+      size_t count = 0;
+      for (const Span span : Matches{c.nfa, c.prefix, s}) {
+        count += span.end - span.begin;
+      }
+      REQUIRE(count == n);
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           begin)
+          .count();
+    };
+    const double small = seconds(2000);
+    const double large = seconds(64000);
+    // 32 times the input, which takes about 1000 times as long when
+    // quadratic.
+    REQUIRE(large < 200 * small);
+  }
+}
@@ -0,0 +1,129 @@
+#include "internal/serialize.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <string>
+#include <vector>
+
+#include "internal/dfa.hpp"
+#include "internal/nfa_creation.hpp"
+#include "internal/parser.hpp"
+
+using RM::Impl::create_dfa, RM::Impl::create_from_parse, RM::Impl::DFA,
+    RM::Impl::DFAView, RM::Impl::load_dfa, RM::Impl::load_error,
+    RM::Impl::load_nfa, RM::Impl::minimize, RM::Impl::NFA,
+    RM::Impl::NFAView, RM::Impl::Parser, RM::Impl::save;
+
+namespace {
+const std::vector<std::string> patterns{
+    "ca(k|v)*e", "(ab)?c*", "(a|b)*abb", "((ab)*b)*a+", R"(a\*)",
+    "[^b]a*[a-c]"};
+const std::vector<std::string> inputs{"",     "cae",  "cakve", "cape",
+                                      "abcc", "c",    "abb",   "babb",
+                                      "abba", "bbaa", "a*",    "aaa"};
+
+NFA build_nfa(const std::string& pattern) {
+  return create_from_parse(Parser{pattern}.parse());
+}
+}  // namespace
+
+TEST_CASE("save and load_nfa") {
+  // One scratch space for every view, resized when the state count changes.
+  NFAView::Scratch scratch;
+  for (const std::string& pattern : patterns) {
+    const NFA nfa = build_nfa(pattern);
+    const std::vector<char> blob = save(nfa);
+    // A misaligned copy must work too.
+    std::vector<char> shifted(blob.size() + 1);
+    std::copy(blob.begin(), blob.end(), shifted.begin() + 1);
+    const NFAView view = load_nfa(blob);
+    const NFAView shifted_view = load_nfa({shifted.data() + 1, blob.size()});
+    REQUIRE(view.error == load_error::OK);
+    REQUIRE(view.size == nfa.size);
+    for (const std::string& input : inputs) {
+      INFO(pattern << " / " << input);
+      REQUIRE(view.match(input) == nfa.match(input));
+      REQUIRE(shifted_view.match(input) == nfa.match(input));
+      REQUIRE(view.match(input, scratch) == nfa.match(input));
+    }
+  }
+
+  SECTION("invalid NFA") {
+    REQUIRE(save(build_nfa("(a")).empty());
+  }
+}
+
+TEST_CASE("save and load_dfa") {
+  for (const std::string& pattern : patterns) {
+    const DFA dfa = minimize(create_dfa(build_nfa(pattern), 100));
+    const std::vector<char> blob = save(dfa);
+    const DFAView view = load_dfa(blob);
+    REQUIRE(view.error == load_error::OK);
+    REQUIRE(view.size == dfa.size);
+    for (const std::string& input : inputs) {
+      INFO(pattern << " / " << input);
+      REQUIRE(view.match(input) == dfa.match(input));
+    }
+  }
+}
+
+TEST_CASE("load errors") {
+  const std::vector<char> nfa_blob = save(build_nfa("ca(k|v)*e"));
+  const std::vector<char> dfa_blob =
+      save(minimize(create_dfa(build_nfa("ca(k|v)*e"), 100)));
+
+  SECTION("layout") {
+    REQUIRE(std::string(dfa_blob.data(), 4) == "RMDF");
+    // Little-endian version 2.
+    REQUIRE(dfa_blob[4] == 3);
+    REQUIRE(dfa_blob[5] == 0);
+    REQUIRE(dfa_blob.size() % 4 == 0);
+    REQUIRE(nfa_blob.size() % 4 == 0);
+  }
+
+  SECTION("truncated") {
+    for (const size_t size : {size_t{0}, size_t{10}, size_t{20},
+                              nfa_blob.size() - 4}) {
+      REQUIRE(load_nfa({nfa_blob.data(), size}).error ==
+              load_error::TRUNCATED);
+    }
+    REQUIRE(load_dfa({dfa_blob.data(), dfa_blob.size() - 4}).error ==
+            load_error::TRUNCATED);
+    REQUIRE(!load_dfa({dfa_blob.data(), 8}).match(""));
+  }
+
+  SECTION("wrong magic") {
+    REQUIRE(load_nfa(dfa_blob).error == load_error::BAD_MAGIC);
+    REQUIRE(load_dfa(nfa_blob).error == load_error::BAD_MAGIC);
+  }
+
+  SECTION("wrong version") {
+    std::vector<char> blob = dfa_blob;
+    blob[4] = 2;
+    REQUIRE(load_dfa(blob).error == load_error::BAD_VERSION);
+  }
+
+  SECTION("state out of range") {
+    std::vector<char> blob = dfa_blob;
+    // The first table entry.
+    blob[284] = 100;
+    REQUIRE(load_dfa(blob).error == load_error::BAD_STATE);
+    REQUIRE(!load_dfa(blob).match("cake"));
+
+    blob = nfa_blob;
+    // The initial state.
+    blob[16] = 100;
+    REQUIRE(load_nfa(blob).error == load_error::BAD_STATE);
+  }
+
+  SECTION("class out of range") {
+    std::vector<char> blob = dfa_blob;
+    // The class count.
+    blob[24] = 0;
+    REQUIRE(load_dfa(blob).error == load_error::BAD_CLASS);
+
+    blob = dfa_blob;
+    // The class of byte 0.
+    blob[28] = 100;
+    REQUIRE(load_dfa(blob).error == load_error::BAD_CLASS);
+  }
+}
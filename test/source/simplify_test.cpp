@@ -0,0 +1,146 @@
+#include "internal/simplify.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <string>
+#include <vector>
+
+#include "internal/nfa_creation.hpp"
+#include "internal/parser.hpp"
+
+using RM::Impl::create_from_parse, RM::Impl::NFA, RM::Impl::ParseNode,
+    RM::Impl::Parser, RM::Impl::simplify, RM::Impl::SimplifyStats;
+
+namespace {
+// The tree as a pattern, with every operand of an operator parenthesized.
+std::string show(const Parser::ParseResult& parsed, ParseNode::index i) {
+  using NodeType = ParseNode::NodeType;
+  const ParseNode& node = parsed.nodes[static_cast<size_t>(i)];
+  switch (node.type) {
+    case NodeType::CHAR:
+      return std::string(1, node.character);
+    case NodeType::CLASS: {
+      std::string result = "[";
+      parsed.sets[static_cast<size_t>(node.set)].for_each_range(
+          [&](char first, char last) {
+            result += first;
+            if (first != last) {
+              result += '-';
+              result += last;
+            }
+          });
+      return result + "]";
+    }
+    case NodeType::CONCAT:
+      return show(parsed, node.left) + show(parsed, node.right);
+    case NodeType::OR:
+      return "(" + show(parsed, node.left) + "|" + show(parsed, node.right) +
+             ")";
+    case NodeType::KLEENE_STAR:
+      return "(" + show(parsed, node.left) + ")*";
+    case NodeType::ONE_OR_MORE:
+      return "(" + show(parsed, node.left) + ")+";
+    case NodeType::OPTIONAL:
+      return "(" + show(parsed, node.left) + ")?";
+  }
+  return "";
+}
+
+std::string simplified(const std::string& pattern) {
+  Parser::ParseResult parsed = Parser{pattern}.parse();
+  simplify(parsed);
+  return show(parsed, parsed.first_node);
+}
+}  // namespace
+
+TEST_CASE("simplify") {
+  SECTION("nested quantifiers") {
+    REQUIRE(simplified("(a*)*") == "(a)*");
+    REQUIRE(simplified("(a?)*") == "(a)*");
+    REQUIRE(simplified("(a+)*") == "(a)*");
+    REQUIRE(simplified("(a*)+") == "(a)*");
+    REQUIRE(simplified("(a?)+") == "(a)*");
+    REQUIRE(simplified("(a+)?") == "(a)*");
+    REQUIRE(simplified("(a+)+") == "(a)+");
+    REQUIRE(simplified("(a?)?") == "(a)?");
+    REQUIRE(simplified("((a*)?)+") == "(a)*");
+    REQUIRE(simplified("(a?b*)+") == "((a)?(b)*)*");
+    REQUIRE(simplified("(a?b*)?") == "(a)?(b)*");
+    REQUIRE(simplified("(a?|b)*") == "([a-b])*");
+    REQUIRE(simplified("(a+|bc*)+") == "((b(c)*|a))+");
+  }
+
+  SECTION("alternatives") {
+    REQUIRE(simplified("a|a") == "a");
+    REQUIRE(simplified("ab|ab|c") == "(ab|c)");
+    REQUIRE(simplified("a|b|c") == "[a-c]");
+    REQUIRE(simplified("a|[b-d]|x") == "[a-dx]");
+    REQUIRE(simplified("(a|b)*abb") == "([a-b])*abb");
+  }
+
+  SECTION("common prefixes and suffixes") {
+    REQUIRE(simplified("abc|abd") == "ab[c-d]");
+    REQUIRE(simplified("xa|ya") == "[x-y]a");
+    REQUIRE(simplified("a|ab") == "a(b)?");
+    REQUIRE(simplified("ab|b") == "(a)?b");
+    REQUIRE(simplified("(ab|ac)|ad") == "a[b-d]");
+    REQUIRE(simplified("cake|cave|cope") == "c(a[kv]|op)e");
+  }
+
+  SECTION("node counts") {
+    Parser::ParseResult parsed = Parser{"abc|abd"}.parse();
+    REQUIRE(simplify(parsed) ==
+            SimplifyStats{.nodes_before = 11, .nodes_after = 5});
+    REQUIRE(parsed.nodes.size() == 5);
+    REQUIRE(parsed.first_node == 4);
+
+    parsed = Parser{"a(b)*"}.parse();
+    REQUIRE(simplify(parsed) ==
+            SimplifyStats{.nodes_before = 4, .nodes_after = 4});
+  }
+
+  SECTION("long concatenations are built in linear size") {
+    for (const std::string& pattern :
+         {std::string(20000, 'a'), std::string{"(a{1000}){30}"},
+          std::string{"((a?){1000}){20}"}}) {
+      Parser::ParseResult parsed = Parser{pattern}.parse();
+      RM::Impl::SimplifyImpl::Simplifier simplifier{parsed};
+      simplifier.build(parsed.first_node);
+      REQUIRE(simplifier.built() <= 2 * parsed.nodes.size());
+    }
+  }
+
+  SECTION("errors are left as they are") {
+    Parser::ParseResult parsed = Parser{"(a"}.parse();
+    REQUIRE(simplify(parsed) ==
+            SimplifyStats{.nodes_before = 0, .nodes_after = 0});
+    REQUIRE(parsed.err_msg == "unbalanced parens");
+  }
+
+  static_assert([] {
+    Parser::ParseResult parsed = Parser{"a|b|c"}.parse();
+    return simplify(parsed).nodes_after;
+  }() == 1);
+}
+
+TEST_CASE("simplify keeps the language") {
+  const std::vector<std::string> patterns{
+      "(a*)*b",      "(a?|b)+",         "abc|abd|ab", "(a|b|a)*c",
+      "x(ab|ac)*|xa", "(a|b)(c|d)|ad",  "((a+)?)+b?", "[ab]|b|c(a|b)",
+      "(ab|b)*",     "a{1,3}|a{2,4}b"};
+  const std::vector<std::string> inputs{
+      "",    "a",   "b",   "ab",  "abc", "abd",  "aab", "xab",
+      "xa",  "xabac", "ac", "ad", "bd",  "cb",   "aaaa", "aaaab",
+      "bab", "abbab", "c",  "ba"};
+  for (const std::string& pattern : patterns) {
+    const NFA plain = create_from_parse(Parser{pattern}.parse());
+    Parser::ParseResult parsed = Parser{pattern}.parse();
+    const SimplifyStats stats = simplify(parsed);
+    REQUIRE(stats.nodes_after <= stats.nodes_before);
+    const NFA rewritten = create_from_parse(std::move(parsed));
+    REQUIRE(rewritten.size <= plain.size);
+    for (const std::string& input : inputs) {
+      INFO(pattern << " / " << input);
+      REQUIRE(rewritten.match(input) == plain.match(input));
+    }
+  }
+}
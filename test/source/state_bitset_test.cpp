@@ -0,0 +1,41 @@
+#include "internal/state_bitset.hpp"
+
+#include <catch2/catch_all.hpp>
+#include <vector>
+
+using RM::Impl::StateBitset;
+
+TEST_CASE("StateBitset") {
+  SECTION("insert and contains") {
+    StateBitset set{130};
+    REQUIRE(set.words.size() == 3);
+    REQUIRE(set.empty());
+    set.insert(0);
+    set.insert(64);
+    set.insert(129);
+    REQUIRE(set.contains(0));
+    REQUIRE(set.contains(64));
+    REQUIRE(set.contains(129));
+    REQUIRE(!set.contains(1));
+    REQUIRE(!set.contains(63));
+    REQUIRE(!set.empty());
+  }
+
+  SECTION("for_each") {
+    StateBitset set{200};
+    set.insert(199);
+    set.insert(3);
+    set.insert(70);
+    std::vector<size_t> visited;
+    set.for_each([&](size_t i) { visited.push_back(i); });
+    REQUIRE(visited == std::vector<size_t>{3, 70, 199});
+  }
+
+  SECTION("clear") {
+    StateBitset set{10};
+    set.insert(5);
+    set.clear();
+    REQUIRE(set.empty());
+    REQUIRE(set.words.size() == 1);
+  }
+}
@@ -0,0 +1,308 @@
+/** rm_grep - print the lines of files that match a regex.
+ *
+ * Every file is mapped into memory and scanned in place, no line is copied.
+ * By default the lines are searched for a match the way grep does it, with
+ * one leftmost-longest search over the whole mapping whose matches are then
+ * attributed to the lines they start on. The pattern never matches '\n', so
+ * no match runs on into the next line. With -x a line has to match as a
+ * whole, using the engine picked with -e.
+ *
+ * Exits with 0 if some line matched, 1 if none did and 2 on errors.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "regex_machine.hpp"
+
+namespace {
+
+constexpr std::string_view usage =
+    "usage: rm_grep [-c | -b] [-x] [-e ENGINE] PATTERN FILE...\n"
+    "  -c  print only the number of matching lines of each file\n"
+    "  -b  print the byte offset of each matching line before it\n"
+    "  -x  match whole lines instead of searching in them\n"
+    "  -e  engine used by -x: auto, nfa, nfa_bitset, lazy_dfa, dfa, bitap\n";
+
+enum class output : char { LINES, COUNT, OFFSETS };
+
+struct Arguments {
+  output mode = output::LINES;
+  bool whole_lines = false;
+  RM::Engine engine = RM::Engine::AUTO;
+  std::string pattern;
+  std::vector<std::string> files;
+  std::string err_msg;
+};
+
+std::optional<RM::Engine> parse_engine(std::string_view name) {
+  if (name == "auto") {
+    return RM::Engine::AUTO;
+  }
+  if (name == "nfa") {
+    return RM::Engine::NFA;
+  }
+  if (name == "nfa_bitset") {
+    return RM::Engine::NFA_BITSET;
+  }
+  if (name == "lazy_dfa") {
+    return RM::Engine::LAZY_DFA;
+  }
+  if (name == "dfa") {
+    return RM::Engine::DFA;
+  }
+  if (name == "bitap") {
+    return RM::Engine::BITAP;
+  }
+  return std::nullopt;
+}
+
+Arguments parse_arguments(int argc, char** argv) {
+  Arguments result;
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+  size_t i = 0;
+  for (; i < args.size() && args[i].starts_with('-') && args[i] != "-";
+       ++i) {
+    if (args[i] == "--") {
+      ++i;
+      break;
+    }
+    if (args[i] == "-c") {
+      result.mode = output::COUNT;
+    } else if (args[i] == "-b") {
+      result.mode = output::OFFSETS;
+    } else if (args[i] == "-x") {
+      result.whole_lines = true;
+    } else if (args[i] == "-e" && i + 1 < args.size()) {
+      const std::optional<RM::Engine> engine = parse_engine(args[++i]);
+      if (!engine) {
+        result.err_msg = "unknown engine " + std::string{args[i]};
+        return result;
+      }
+      result.engine = *engine;
+    } else {
+      result.err_msg = "unknown option " + std::string{args[i]};
+      return result;
+    }
+  }
+  if (args.size() - i < 2) {
+    result.err_msg = "expected a pattern and at least one file";
+    return result;
+  }
+  result.pattern = args[i++];
+  result.files.assign(args.begin() + static_cast<std::ptrdiff_t>(i),
+                      args.end());
+  return result;
+}
+
+/** A file mapped read-only into memory for as long as the object lives. */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      err_msg = std::strerror(errno);
+      return;
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) == -1) {
+      err_msg = std::strerror(errno);
+    } else if (info.st_size > 0) {
+      size = static_cast<size_t>(info.st_size);
+      void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped == MAP_FAILED) {
+        err_msg = std::strerror(errno);
+        size = 0;
+      } else {
+        data = static_cast<const char*>(mapped);
+        ::madvise(mapped, size, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data != nullptr) {
+      ::munmap(const_cast<char*>(data), size);
+    }
+  }
+
+  std::string_view text() const { return {data, size}; }
+
+  std::string err_msg;
+
+ private:
+  const char* data = nullptr;
+  size_t size = 0;
+};
+
+// Call `f(begin, end)` for every line of `text`, without the newline. A
+// newline at the very end does not start another line.
+template <typename F>
+void for_each_line(std::string_view text, F&& f) {
+  size_t begin = 0;
+  while (begin < text.size()) {
+    const void* found =
+        std::memchr(text.data() + begin, '\n', text.size() - begin);
+    const size_t end =
+        found == nullptr
+            ? text.size()
+            : static_cast<size_t>(static_cast<const char*>(found) -
+                                  text.data());
+    f(begin, end);
+    begin = end + 1;
+  }
+}
+
+/** Collects the output and writes it to stdout in large blocks. */
+class Output {
+ public:
+  Output() { buffer.reserve(flush_size); }
+  Output(const Output&) = delete;
+  Output& operator=(const Output&) = delete;
+  ~Output() { flush(); }
+
+  void write(std::string_view s) {
+    buffer.append(s);
+    if (buffer.size() >= flush_size) {
+      flush();
+    }
+  }
+
+  void flush() {
+    std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+    buffer.clear();
+  }
+
+ private:
+  static constexpr size_t flush_size = size_t{1} << 16;
+  std::string buffer;
+};
+
+class Grep {
+ public:
+  Grep(const Arguments& arguments, Output& output)
+      : args{arguments},
+        matcher{arguments.pattern,
+                {.engine = arguments.engine, .never_newline = true}},
+        out{output} {}
+
+  const std::string& err_msg() const { return matcher.err_msg; }
+
+  // Returns the number of matching lines.
+  size_t scan(const std::string& name, std::string_view text) {
+    size_t count = 0;
+    const auto report = [&](size_t begin, size_t end) {
+      ++count;
+      if (args.mode == output::COUNT) {
+        return;
+      }
+      write_name(name);
+      if (args.mode == output::OFFSETS) {
+        out.write(std::to_string(begin));
+        out.write(":");
+      }
+      out.write(text.substr(begin, end - begin));
+      out.write("\n");
+    };
+
+    if (args.whole_lines) {
+      // A session matches a line in place, without copying it.
+      RM::Matcher::Session session = matcher.session();
+      for_each_line(text, [&](size_t begin, size_t end) {
+        session.reset();
+        session.feed(text.substr(begin, end - begin));
+        if (session.finish()) {
+          report(begin, end);
+        }
+      });
+    } else if (matcher.match("")) {
+      for_each_line(text, report);
+    } else {
+      // A non-empty match starts before the end of the text. Only the first
+      // match on each line is reported.
+      size_t next_line = 0;
+      for (const RM::Span span : matcher.find_all(text)) {
+        if (span.begin < next_line) {
+          continue;
+        }
+        const size_t newline =
+            span.begin == 0 ? std::string_view::npos
+                            : text.rfind('\n', span.begin - 1);
+        const size_t begin =
+            newline == std::string_view::npos ? 0 : newline + 1;
+        const size_t end = std::min(text.find('\n', span.begin), text.size());
+        report(begin, end);
+        next_line = end + 1;
+      }
+    }
+
+    if (args.mode == output::COUNT) {
+      write_name(name);
+      out.write(std::to_string(count));
+      out.write("\n");
+    }
+    return count;
+  }
+
+ private:
+  void write_name(const std::string& name) {
+    if (args.files.size() > 1) {
+      out.write(name);
+      out.write(":");
+    }
+  }
+
+  const Arguments& args;
+  const RM::Matcher matcher;
+  Output& out;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const Arguments args = parse_arguments(argc, argv);
+  if (!args.err_msg.empty()) {
+    std::fprintf(stderr, "rm_grep: %s\n%s", args.err_msg.c_str(),
+                 usage.data());
+    return 2;
+  }
+  Output out;
+  Grep grep{args, out};
+  if (!grep.err_msg().empty()) {
+    std::fprintf(stderr, "rm_grep: %s\n", grep.err_msg().c_str());
+    return 2;
+  }
+
+  bool matched = false;
+  bool failed = false;
+  for (const std::string& name : args.files) {
+    const MappedFile file{name};
+    if (!file.err_msg.empty()) {
+      out.flush();
+      std::fprintf(stderr, "rm_grep: %s: %s\n", name.c_str(),
+                   file.err_msg.c_str());
+      failed = true;
+      continue;
+    }
+    matched = grep.scan(name, file.text()) > 0 || matched;
+  }
+  if (failed) {
+    return 2;
+  }
+  return matched ? 0 : 1;
+}
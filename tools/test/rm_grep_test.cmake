@@ -0,0 +1,43 @@
+cmake_minimum_required(VERSION 3.14)
+
+# Runs rm_grep on small files and checks what it prints and returns.
+# Usage: cmake -DRM_GREP=<rm_grep> -DWORK_DIR=<dir> -P rm_grep_test.cmake
+
+foreach(var IN ITEMS RM_GREP WORK_DIR)
+  if(NOT DEFINED "${var}")
+    message(FATAL_ERROR "${var} must be defined")
+  endif()
+endforeach()
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+file(WRITE "${WORK_DIR}/cakes.txt" "cake\ncape\ncavve\na cake\n")
+file(WRITE "${WORK_DIR}/lines.txt" "x\nz\nxz\n")
+
+# check(<expected output> <expected exit code> <rm_grep arguments>...)
+function(check expected code)
+  execute_process(
+      COMMAND "${RM_GREP}" ${ARGN}
+      WORKING_DIRECTORY "${WORK_DIR}"
+      OUTPUT_VARIABLE output
+      RESULT_VARIABLE result
+  )
+  if(NOT output STREQUAL expected OR NOT result EQUAL code)
+    string(REPLACE ";" " " arguments "${ARGN}")
+    message(
+        SEND_ERROR
+        "rm_grep ${arguments}\n"
+        "expected (exit ${code}):\n${expected}\n"
+        "got (exit ${result}):\n${output}"
+    )
+  endif()
+endfunction()
+
+check("cake\ncavve\na cake\n" 0 "ca(k|v)*e" cakes.txt)
+check("3\n" 0 -c "ca(k|v)*e" cakes.txt)
+check("0:cake\n10:cavve\n16:a cake\n" 0 -b "ca(k|v)*e" cakes.txt)
+check("cake\ncavve\n" 0 -x "ca(k|v)*e" cakes.txt)
+check("" 1 "dog" cakes.txt)
+
+# "[^q]" reads '\n' too, but a match never runs on into the next line.
+check("xz\n" 0 "x[^q]*z" lines.txt)
+check("1\n" 0 -c "x[^q]*z" lines.txt)